@@ -14,7 +14,7 @@ emit_ninja()
 	_ast_sub_incs=""
 	for _d in "$LIBAST_SRC"/*/; do
 		case $_d in
-		*/features/|*/man/)	continue ;;
+		*/features/|*/man/|*/tests/)	continue ;;
 		esac
 		_ast_sub_incs="$_ast_sub_incs -I$_d"
 	done
@@ -25,6 +25,7 @@ emit_ninja()
 	_cmd_incs="$_std_inc -I$FEATDIR/libcmd -I$LIBCMD_SRC -I$FEATDIR/libast -I$LIBAST_SRC/include"
 	_ksh_incs="$_std_inc -I$FEATDIR/ksh26 -I$KSH_SRC -I$KSH_SRC/include -I$FEATDIR/libast -I$LIBAST_SRC/include -I$LIBCMD_SRC"
 	_pty_incs="$_std_inc -I$FEATDIR/pty -I$PTY_SRC -I$LIBCMD_SRC -I$FEATDIR/libast -I$LIBAST_SRC/include"
+	_vmtest_incs="$_std_inc -I$FEATDIR/libast -I$LIBAST_SRC/include"
 
 	{
 		# Preservation 9: Self-documenting header
@@ -51,6 +52,7 @@ ast_cflags = -D_BLD_ast -DHOSTTYPE='"$HOSTTYPE"' \$cflags $_ast_incs
 cmd_cflags = -D_BLD_cmd -DERROR_CATALOG='"libcmd"' -DHOSTTYPE='"$HOSTTYPE"' \$cflags $_cmd_incs
 ksh_cflags = -D_BLD_ksh -DSH_DICT='"libshell"' -D_API_ast=20100309 \$cflags $_ksh_incs
 pty_cflags = -DERROR_CATALOG='"builtin"' \$cflags $_pty_incs
+vmtest_cflags = \$cflags $_vmtest_incs
 
 VARS
 
@@ -80,6 +82,12 @@ rule cc_pty
   deps = gcc
   description = CC [pty] $out
 
+rule cc_vmtest
+  command = $cc $vmtest_cflags -MD -MF $out.d -c $in -o $out
+  depfile = $out.d
+  deps = gcc
+  description = CC [vmtest] $out
+
 rule ar
   command = rm -f $out && ar rcs $out $in
   description = AR $out
@@ -169,6 +177,11 @@ RULES
 		fi
 		printf '  libs = %s\n\n' "$LIBS"
 
+		# ── vmtest binary (for tests) ───────────────────────
+		printf 'build %s/vmtest.o: cc_vmtest %s/tests/vmtest.c\n' "$OBJDIR" "$LIBAST_SRC"
+		printf 'build %s/vmtest: link %s/vmtest.o %s/libast.a\n' "$BINDIR" "$OBJDIR" "$LIBDIR"
+		printf '  libs = %s\n\n' "$LIBS"
+
 		# ── Default target ──────────────────────────────────
 		printf 'default %s/ksh %s/shcomp %s/pty\n' "$BINDIR" "$BINDIR" "$BINDIR"
 
@@ -241,6 +254,7 @@ NINJA
 			_extra_deps=""
 			case "$_tname" in
 			pty) _extra_deps=" $BINDIR/pty" ;;
+			vmalloc) _extra_deps=" $BINDIR/vmtest" ;;
 			esac
 
 			# C locale variant
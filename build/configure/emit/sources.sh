@@ -5,6 +5,7 @@ collect_libast_sources()
 {
 	find "$LIBAST_SRC" -name '*.c' -not -path '*/features/*' \
 		-not -path '*/man/*' \
+		-not -path '*/tests/*' \
 		-not -name 'sfdcfilter.c' \
 		-not -name 'omitted.c' | sort
 	putln "$FEATDIR/libast/conftab.c"
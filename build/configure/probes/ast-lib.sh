@@ -93,7 +93,7 @@ EOF
 		   getconf getdents getdirentries getdtablesize \
 		   gethostname getpagesize getrlimit getuniverse \
 		   glob iswblank iswctype killpg link localeconv madvise \
-		   mbtowc mbrtowc memalign memdup \
+		   mbtowc mbrtowc memalign memdup memmem \
 		   mktemp mktime \
 		   opendir openat pathconf pipe2 posix_close dup3 ppoll mkostemp \
 		   rand_r \
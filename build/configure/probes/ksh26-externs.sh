@@ -56,6 +56,12 @@ probe_ksh26_externs()
 "
 	fi
 
+	# lib memmem string.h — used for literal ${var/pat/rep} searches
+	if _mc_lib "memmem"; then
+		_defs="${_defs}#define _lib_memmem	1	/* memmem() in default lib(s) */
+"
+	fi
+
 	# extern nice, setreuid, setregid — these check if the functions
 	# need explicit extern declarations. On modern systems they're
 	# declared in headers, so no extern output is generated.
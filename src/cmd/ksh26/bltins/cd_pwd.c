@@ -317,6 +317,7 @@ success:
 			dir[len] = 0;
 		nv_putval(pwdnod,dir,NV_RDONLY);
 		nv_onattr(pwdnod,NV_EXPORT);
+		env_change();
 		sh.pwd = sh_strdup(dir);
 	}
 	else
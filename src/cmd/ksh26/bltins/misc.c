@@ -65,6 +65,7 @@ static void     noexport(Namval_t* np, void *data)
 	if(sh.subshell && !sh.subshare)
 		sh_assignok(np,0);
 	nv_offattr(np,NV_EXPORT);
+	env_change();
 }
 
 /*
@@ -292,6 +293,7 @@ int    b_dot_cmd(int n,char *argv[],Shbltin_t *context)
 			UNREACHABLE();
 		}
 		filename = path_fullname(stkptr(sh.stk,PATH_OFFSET));
+		sh_tcacheopen(fd,filename);
 	}
 	*prevscope = sh.st;
 	sh.st.lineno = np?((struct functnod*)nv_funtree(np))->functline:1;
@@ -413,9 +415,18 @@ int    b_shift(int n, char *argv[], Shbltin_t *context)
 
 int    b_wait(int n,char *argv[],Shbltin_t *context)
 {
+	char	*pvar = NULL;
+	int	any = 0;
+	pid_t	pid;
 	NOT_USED(context);
 	while((n = optget(argv,sh_optwait))) switch(n)
 	{
+		case 'n':
+			any = 1;
+			break;
+		case 'p':
+			pvar = opt_info.arg;
+			break;
 		case ':':
 			errormsg(SH_DICT,2, "%s", opt_info.arg);
 			break;
@@ -430,7 +441,24 @@ int    b_wait(int n,char *argv[],Shbltin_t *context)
 		UNREACHABLE();
 	}
 	argv += opt_info.index;
-	job_bwait(argv);
+	if(!any)
+	{
+		job_bwait(argv);
+		return sh.exitval;
+	}
+	pid = job_bwaitany(argv);
+	if(pvar)
+	{
+		Namval_t *np = nv_open(pvar,sh.var_tree,NV_VARNAME);
+		if(pid)
+		{
+			sfprintf(sh.strbuf,"%jd",(Sflong_t)pid);
+			nv_putval(np,sfstruse(sh.strbuf),0);
+		}
+		else
+			nv_unset(np,0);
+		nv_close(np);
+	}
 	return sh.exitval;
 }
 
@@ -519,6 +547,168 @@ int    b_jobs(int n,char *argv[],Shbltin_t *context)
 	return sh.exitval;
 }
 
+/*
+ * Start <argv> with <item> appended as a background job and return its process ID
+ */
+static pid_t jobpool_start(char *argv[], int argc, char *item)
+{
+	struct dolnod	*dp = stkalloc(sh.stk, sizeof(struct dolnod) + ARG_SPARE*sizeof(char*) + (argc+1)*sizeof(char*));
+	struct comnod	*t = stkalloc(sh.stk,sizeof(struct comnod));
+	struct forknod	*fp = stkalloc(sh.stk,sizeof(struct forknod));
+	pid_t		bckpid = sh.bckpid, pid;
+	int		ioset = sh.st.ioset, interactive = sh_isstate(SH_INTERACTIVE);
+	memset(t, 0, sizeof(struct comnod));
+	memset(fp, 0, sizeof(struct forknod));
+	dp->dolnum = argc+1;
+	dp->dolbot = ARG_SPARE;
+	memcpy(dp->dolval+ARG_SPARE, argv, argc*sizeof(char*));
+	dp->dolval[ARG_SPARE+argc] = item;
+	dp->dolval[ARG_SPARE+argc+1] = 0;
+	t->comarg.dp = dp;
+	fp->forktyp = TFORK|FAMP|FINT;
+	fp->forktre = (Shnode_t*)t;
+	/* standard input of each job is /dev/null, even if it is redirected for jobpool itself */
+	sh.st.ioset = 0;
+	/* don't print job numbers */
+	sh_offstate(SH_INTERACTIVE);
+	sh_exec((Shnode_t*)fp,0);
+	if(interactive)
+		sh_onstate(SH_INTERACTIVE);
+	sh.st.ioset = ioset;
+	pid = sh.bckpid;
+	sh.bckpid = bckpid;
+	return pid;
+}
+
+int    b_jobpool(int argc,char *argv[],Shbltin_t *context)
+{
+	char		*avar = NULL, *svar = NULL, *item, **items = NULL;
+	void		*savptr;
+	int		savtop;
+	Namval_t	*np;
+	Sfio_t		*iop = NULL;
+	pid_t		*pids;
+	int		*index;
+	long		maxjobs = 0;
+	int		n, nrun = 0, next = 0, failed = 0;
+	NOT_USED(context);
+	while((n = optget(argv,sh_optjobpool))) switch(n)
+	{
+	    case 'a':
+		avar = opt_info.arg;
+		break;
+	    case 'j':
+		if((maxjobs = opt_info.num) <= 0)
+		{
+			errormsg(SH_DICT,ERROR_exit(2),e_number,opt_info.arg);
+			UNREACHABLE();
+		}
+		break;
+	    case 's':
+		svar = opt_info.arg;
+		break;
+	    case ':':
+		errormsg(SH_DICT,2, "%s", opt_info.arg);
+		break;
+	    case '?':
+		/* self-doc: write to standard output */
+		error(ERROR_USAGE|ERROR_OUTPUT, STDOUT_FILENO, "%s", opt_info.arg);
+		return 0;
+	}
+	argv += opt_info.index;
+	if(error_info.errors || !*argv)
+	{
+		errormsg(SH_DICT,ERROR_usage(2),"%s",optusage(NULL));
+		UNREACHABLE();
+	}
+	argc -= opt_info.index;
+	if(maxjobs==0 && (maxjobs = sysconf(_SC_NPROCESSORS_ONLN)) <= 0)
+		maxjobs = 1;
+	if(maxjobs > sh.lim.child_max)
+		maxjobs = sh.lim.child_max;
+	if(avar)
+	{
+		/* copy the items, as the jobs are started from the current shell environment */
+		n = 0;
+		if(!(np = nv_open(avar,sh.var_tree,NV_VARNAME|NV_NOADD)))
+			;
+		else if(!nv_isarray(np))
+			n = !nv_isnull(np);
+		else if(nv_putsub(np, NULL, ARRAY_SCAN))
+		{
+			do
+				n++;
+			while(nv_nextsub(np));
+		}
+		items = stkalloc(sh.stk,(n+1)*sizeof(char*));
+		if(n && (!nv_isarray(np) || nv_putsub(np, NULL, ARRAY_SCAN)))
+		{
+			n = 0;
+			do
+			{
+				if(item = nv_getval(np))
+					items[n++] = stkcopy(sh.stk,item);
+			}
+			while(nv_isarray(np) && nv_nextsub(np));
+		}
+		items[n] = NULL;
+	}
+	else if(!(iop = sh.sftable[0]) && !(iop = sh_iostream(0)))
+		return 2;
+	if(svar)
+	{
+		if((np = nv_open(svar,sh.var_tree,NV_VARNAME|NV_NOADD)) && !nv_isnull(np))
+			nv_unset(np,0);
+	}
+	pids = stkalloc(sh.stk,maxjobs*sizeof(pid_t));
+	index = stkalloc(sh.stk,maxjobs*sizeof(int));
+	while(1)
+	{
+		if(nrun < maxjobs)
+		{
+			/* start the next item; it only has to last until the job is started */
+			savptr = stkfreeze(sh.stk,0);
+			savtop = stktell(sh.stk);
+			if(items)
+				item = items[next];
+			else if(item = sfgetr(iop,'\n',SFIO_STRING))
+				item = stkcopy(sh.stk,item);
+			else if(item = sfgetr(iop,'\n',-1))
+			{
+				/* last line without newline */
+				n = sfvalue(iop);
+				item = memcpy(stkalloc(sh.stk,n+1),item,n);
+				item[n] = 0;
+			}
+			if(item)
+			{
+				if((pids[nrun] = jobpool_start(argv,argc,item)) > 0)
+					index[nrun++] = next;
+				next++;
+				stkset(sh.stk,savptr,savtop);
+				continue;
+			}
+			stkset(sh.stk,savptr,savtop);
+		}
+		if(nrun==0 || (n = job_waitany(pids,nrun,0)) < 0)
+			break;
+		job_wait(pids[n]);
+		if(sh.exitval)
+			failed = 1;
+		if(svar)
+		{
+			sfprintf(sh.strbuf,"%s[%d]",svar,index[n]);
+			np = nv_open(sfstruse(sh.strbuf),sh.var_tree,NV_VARNAME);
+			sfprintf(sh.strbuf,"%d",sh.exitval);
+			nv_putval(np,sfstruse(sh.strbuf),0);
+			nv_close(np);
+		}
+		pids[n] = pids[--nrun];
+		index[n] = index[nrun];
+	}
+	return failed;
+}
+
 /*
  * times command
  */
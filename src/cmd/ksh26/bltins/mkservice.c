@@ -357,7 +357,7 @@ static char* setdisc(Namval_t* np, const char* event, Namval_t* action, Namfun_t
 		else
 		{
 			if (nq = sp->disc[i])
-				free(nq);
+				nv_freenode(nq);
 			if (action)
 				sp->disc[i] = action;
 			else
@@ -206,6 +206,7 @@ int    b_alias(int argc,char *argv[],Shbltin_t *context)
 		if(rflag)				/* hash -r: clear hash table */
 			nv_scan(troot,nv_rehash,NULL,NV_TAGGED,NV_TAGGED);
 	}
+	sh_cmdchanged();
 	return setall(argv,flag,troot,&tdata);
 }
 
@@ -1372,7 +1373,10 @@ static int unall(int argc, char **argv, Dt_t *troot)
 	if(troot==sh.var_tree)
 		nflag |= NV_VARNAME;
 	else
+	{
 		nflag = NV_NOSCOPE;
+		sh_cmdchanged();
+	}
 	if(all)
 	{
 		if(dtfirst(troot))
@@ -103,6 +103,7 @@ const struct shtable3 shtab_builtins[] =
 	"disown",	NV_BLTIN|BLT_ENV,		bltin(bg),
 	"kill",		NV_BLTIN|BLT_ENV,		bltin(kill),
 	"jobs",		NV_BLTIN|BLT_ENV,		bltin(jobs),
+	"jobpool",	NV_BLTIN|BLT_ENV,		bltin(jobpool),
 	"stop",		NV_BLTIN|BLT_ENV,		bltin(kill),
 	"suspend", 	NV_BLTIN|BLT_ENV,		bltin(suspend),
 	"false",	NV_BLTIN|BLT_ENV,		bltin(false),
@@ -969,6 +970,38 @@ _JOB_
 "[+SEE ALSO?\bwait\b(1), \bps\b(1), \bfg\b(1), \bbg\b(1)]"
 ;
 
+const char sh_optjobpool[] =
+"[-1c?\n@(#)$Id: jobpool (ksh 93u+m) 2026-10-16 $\n]"
+"[--catalog?" SH_DICT "]"
+"[+NAME?jobpool - run a command for each item with bounded concurrency]"
+"[+DESCRIPTION?\bjobpool\b runs \acommand\a once for each item, with the "
+	"item appended to the \aarg\as, as a background job. At most "
+	"\amaxjobs\a of these jobs run at the same time; as soon as any one "
+	"of them terminates, the next item is started. \bjobpool\b returns "
+	"when all jobs have terminated.]"
+"[+?Items are the elements of the indexed array given by \b-a\b, or else "
+	"the lines read from standard input. Each job is run as if by "
+	"\acommand\a \aarg\a ... \aitem\a \b&\b, so \acommand\a can be a "
+	"function or built-in as well as an external command. Standard input "
+	"of each job is \b/dev/null\b.]"
+"[a]:[array?Take the items from the elements of the indexed array \aarray\a "
+	"instead of from standard input.]"
+"[j]#[maxjobs?Run at most \amaxjobs\a jobs at a time. The default is the "
+	"number of processors online.]"
+"[s]:[var?Store the exit status of the job for the \an\ath item (counting "
+	"from 0) in element \an\a of the indexed array \avar\a.]"
+"\n"
+"\ncommand [arg ...]\n"
+"\n"
+"[+EXIT STATUS?]{"
+	"[+0?Every job exited with status 0.]"
+	"[+1?One or more jobs exited with a non-zero status.]"
+	"[+>1?An error occurred.]"
+"}"
+
+"[+SEE ALSO?\bwait\b(1), \bjobs\b(1), \bxargs\b(1)]"
+;
+
 const char sh_opthash[] =
 "[-1c?\n@(#)$Id: hash (ksh 93u+m) 2024-06-30 $\n]"
 "[--catalog?" SH_DICT "]"
@@ -2076,7 +2109,7 @@ const char sh_optunalias[] =
 ;
 
 const char sh_optwait[]	=
-"[-1c?\n@(#)$Id: wait (AT&T Research) 1999-06-17 $\n]"
+"[-1c?\n@(#)$Id: wait (ksh 93u+m) 2026-10-16 $\n]"
 "[--catalog?" SH_DICT "]"
 "[+NAME?wait - wait for process or job completion]"
 "[+DESCRIPTION?\bwait\b with no operands, waits until all jobs "
@@ -2087,6 +2120,12 @@ _JOB_
 "[+?If one or more \ajob\a operands is a process ID or process group ID "
 	"not known by the current shell environment, \bwait\b treats each "
 	"of them as if it were a process that exited with status 127.]"
+"[n?Wait until any one of the \ajob\as, or of all known jobs if there are "
+	"no operands, has terminated, and return its exit status. A job "
+	"that has already terminated is returned at once. The exit status "
+	"is 127 if there are no jobs to wait for.]"
+"[p]:[var?With \b-n\b, assign the process ID of the job that terminated "
+	"to \avar\a, or unset \avar\a if there was none.]"
 "\n"
 "\n[job ...]\n"
 "\n"
@@ -117,10 +117,15 @@ const Shtable_t shtab_stats[] =
 	"funcalls",		STAT_FUNCT,
 	"globs",		STAT_GLOBS,
 	"linesread",		STAT_READS,
+	"nv_bytes",		STAT_NVBYTES,
 	"nv_cachehit",		STAT_NVHITS,
+	"nv_nodes",		STAT_NVNODES,
 	"nv_opens",		STAT_NVOPEN,
 	"pathsearch",		STAT_PATHS,
 	"posixfuncall",		STAT_SVFUNCT,
+	"re_cachehit",		STAT_REHITS,
+	"re_cachemiss",		STAT_REMISSES,
+	"re_evict",		STAT_REEVICT,
 	"simplecmds",		STAT_SCMDS,
 	"spawns",		STAT_SPAWN,
 	"subshell",		STAT_SUBSHELL
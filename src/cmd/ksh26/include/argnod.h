@@ -47,6 +47,8 @@ struct comnod
 	void		*comnamp;
 	void		*comnamq;
 	void		*comstate;
+	void		*comcache;	/* function or builtin found by last lookup, or NULL */
+	unsigned int	comgen;		/* value of sh.cmdgen when comcache was set */
 	int		comline;
 };
 
@@ -78,6 +78,7 @@ extern int b_unalias(int, char*[],Shbltin_t*);
 
 /* The following are for job control */
 extern int b_jobs(int, char*[],Shbltin_t*);
+extern int b_jobpool(int, char*[],Shbltin_t*);
 extern int b_kill(int, char*[],Shbltin_t*);
 extern int b_bg(int, char*[],Shbltin_t*);
 extern int b_suspend(int, char*[],Shbltin_t*);
@@ -173,6 +174,7 @@ extern const char sh_opthash[];
 extern const char sh_opthist[];
 #endif /* !SHOPT_SCRIPTONLY */
 extern const char sh_optjobs[];
+extern const char sh_optjobpool[];
 extern const char sh_optkill[];
 extern const char sh_optstop[];
 extern const char sh_optsuspend[];
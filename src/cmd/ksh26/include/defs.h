@@ -198,6 +198,9 @@ extern char		*sh_getcwd(void);
 #define sh_getstate()	(sh.st.states)
 #define sh_setstate(x)	(sh.st.states = (x))
 
+/* invalidate command lookups cached in simple command nodes; generation 0 is never valid */
+#define sh_cmdchanged()	((void)(++sh.cmdgen || ++sh.cmdgen))
+
 #define sh_sigcheck()	do { if(sh.trapnote & SH_SIGSET) sh_exit(SH_EXITSIG); } while(0)
 
 extern int32_t		sh_mailchk;
@@ -224,13 +227,18 @@ extern const char	e_scriptonly[];
 #   define	STAT_FUNCT	4
 #   define	STAT_GLOBS	5
 #   define	STAT_READS	6
-#   define	STAT_NVHITS	7
-#   define	STAT_NVOPEN	8
-#   define	STAT_PATHS	9
-#   define	STAT_SVFUNCT	10
-#   define	STAT_SCMDS	11
-#   define	STAT_SPAWN	12
-#   define	STAT_SUBSHELL	13
+#   define	STAT_NVBYTES	7
+#   define	STAT_NVHITS	8
+#   define	STAT_NVNODES	9
+#   define	STAT_NVOPEN	10
+#   define	STAT_PATHS	11
+#   define	STAT_SVFUNCT	12
+#   define	STAT_REHITS	13
+#   define	STAT_REMISSES	14
+#   define	STAT_REEVICT	15
+#   define	STAT_SCMDS	16
+#   define	STAT_SPAWN	17
+#   define	STAT_SUBSHELL	18
     extern const Shtable_t shtab_stats[];
 #   define sh_stats(x)	(sh.stats[(x)]++)
 #else
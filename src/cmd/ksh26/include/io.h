@@ -92,6 +92,7 @@ extern void	sh_iounpipe(void);
 extern int	sh_chkopen(const char*);
 extern int	sh_ioaccess(int,int);
 extern int	sh_isdevfd(const char*);
+extern void	sh_ioheredocclose(void);
 
 /* the following are readonly */
 extern const char	e_copexists[];
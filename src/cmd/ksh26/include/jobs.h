@@ -41,7 +41,9 @@
 struct process
 {
 	struct process *p_nxtjob;	/* next job structure */
+	struct process *p_prvjob;	/* previous job structure */
 	struct process *p_nxtproc;	/* next process in current job */
+	struct process *p_nxtpid;	/* next process in same process ID hash bucket */
 	int		*p_exitval;	/* place to store the exitval */
 	pid_t		p_pid;		/* process ID */
 	pid_t		p_pgrp;		/* process group */
@@ -117,9 +119,11 @@ extern const char	e_no_start[];
 
 extern void	job_clear(void);
 extern void	job_bwait(char**);
+extern pid_t	job_bwaitany(char**);
 extern int	job_walk(Sfio_t*,int(*)(struct process*,int),int,char*[]);
 extern int	job_kill(struct process*,int);
 extern int	job_wait(pid_t);
+extern int	job_waitany(const pid_t*,int,int);
 extern int	job_post(pid_t,pid_t);
 extern void	*job_subsave(void);
 extern void	job_subrestore(void*);
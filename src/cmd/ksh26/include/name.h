@@ -146,6 +146,7 @@ extern int		array_maxindex(Namval_t*);
 extern char 		*nv_endsubscript(Namval_t*, char*, int);
 extern Namfun_t 	*nv_enforcedisc(Namval_t*);
 extern int		nv_arrayisset(Namval_t*, Namarr_t*);
+extern void		*nv_arraynum(Namval_t*, void**, size_t);
 extern int		nv_arraysettype(Namval_t*, Namval_t*,const char*,int);
 extern int		nv_aimax(Namval_t*);
 extern int		nv_atypeindex(Namval_t*, const char*);
@@ -185,6 +186,11 @@ extern Namval_t		*nv_typeparent(Namval_t*);
 extern int		nv_istable(Namval_t*);
 extern size_t		nv_datasize(Namval_t*, size_t*);
 extern Namfun_t		*nv_mapchar(Namval_t*, const char*);
+extern Namval_t		*nv_newnode(const char*);
+extern void		nv_freenode(Namval_t*);
+#if SHOPT_STATS
+   extern void		nv_nodestats(Namval_t*, Namval_t*);
+#endif /* SHOPT_STATS */
 #if SHOPT_FIXEDARRAY
    extern int		nv_arrfixed(Namval_t*, Sfio_t*, int, char*);
 #endif /* SHOPT_FIXEDARRAY */
@@ -287,6 +287,7 @@ struct Shell_s
 	int		path_err;	/* last error on path search */
 	Dt_t		*var_base;	/* global level variables */
 	Dt_t		*fun_base;	/* global level functions */
+	unsigned int	cmdgen;		/* command lookup generation, see sh_cmdchanged() */
 	Dt_t		*openmatch;
 	Namval_t	*namespace;	/* current active namespace */
 	Namval_t	*last_table;	/* last table used in last nv_open */
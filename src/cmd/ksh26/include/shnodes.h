@@ -119,6 +119,19 @@ struct swnod
 	struct regnod	*swlst;
 	struct ionod	*swio;
 	int		swline;
+	struct swtab	*swtab;
+};
+
+/* compiled patterns of a case statement; see sh/casetab.c */
+struct swtab
+{
+	struct regnod	**arm;		/* the arms in order */
+	int		narm;
+	int		*first;		/* index of the first pattern of each arm */
+	struct swpat	*pat;		/* the patterns in the order they are tried */
+	int		npat;
+	int		*hash;		/* literal patterns by hash, index+1 */
+	unsigned int	mask;		/* hash table size-1, 0 if no literals */
 };
 
 struct regnod
@@ -209,8 +222,13 @@ union Shnode_u
 
 extern void			sh_freeup(void);
 extern void			sh_funstaks(struct slnod*,int);
+extern void			sh_casecomp(struct swnod*);
+extern int			sh_casematch(const struct swtab*, int, const char*, int);
 extern Sfio_t 			*sh_subshell(Shnode_t*, volatile int, int);
 extern int			sh_tdump(Sfio_t*, const Shnode_t*);
 extern Shnode_t			*sh_trestore(Sfio_t*);
+extern void			sh_tcacheopen(int, const char*);
+extern void			sh_tcacheadd(Sfio_t*, const Shnode_t*);
+extern void			sh_tcacheclose(int);
 
 #endif /* _SHNODES_H */
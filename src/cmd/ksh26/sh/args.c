@@ -779,7 +779,7 @@ struct argnod *sh_argprocsub(struct argnod *argp)
 #else
 	/* remember the FIFO for cleanup in case the command never opens it (see fifo_cleanup(), xec.c) */
 	if(!sh.fifo_tree)
-		sh.fifo_tree = dtopen(&_Nvdisc,Dtoset);
+		sh.fifo_tree = dtopen(&_Nvdisc,Dtohash);
 	nv_search(sh.fifo,sh.fifo_tree,NV_ADD);
 	free(sh.fifo);
 	sh.fifo = 0;
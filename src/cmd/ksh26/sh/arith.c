@@ -185,7 +185,7 @@ static Namval_t *scope(Namval_t *np,struct lval *lvalue,int assign)
 			{
 				ap = nv_arrayptr(np);
 				if(ap && !ap->table)
-					ap->table = dtopen(&_Nvdisc,Dtoset);
+					ap->table = dtopen(&_Nvdisc,Dtohash);
 				if(ap && ap->table && (nq=nv_search(nv_getsub(np),ap->table,NV_ADD)))
 					nq->nvmeta = np;
 				if(nq && nv_isnull(nq))
@@ -564,6 +564,140 @@ static Sfdouble_t arith(const char **ptr, struct lval *lvalue, int type, Sfdoubl
 	return r;
 }
 
+/*
+ * Cache of compiled arithmetic expressions, keyed by the expression text.
+ * Expressions are compiled with ARITH_COMP so that variables are bound to
+ * the current scope when the code is executed, not when it is compiled.
+ * Each entry has its own stack that holds both the text and the code.
+ * Expressions that call functions are not cached, as a compiled call to a
+ * user-defined math function refers to the function's node.
+ */
+#define ACACHE	64
+
+static struct acache
+{
+	Stk_t		*stk;		/* stack holding text and code */
+	char		*text;		/* expression text */
+	Arith_t		*ep;		/* compiled code */
+	unsigned long	hash;		/* hash of text */
+	size_t		len;		/* length of text */
+	size_t		used;		/* number of characters compiled */
+	unsigned int	busy;		/* evaluations in progress */
+	int		mode;		/* error mode */
+	char		options;	/* options that affect compilation */
+	char		radix;		/* radix point when compiled */
+} acache[ACACHE];
+
+static int arith_options(void)
+{
+	return (sh_isoption(SH_POSIX)!=0) | (sh_isoption(sh.bltinfun==b_let ? SH_LETOCTAL : SH_POSIX)!=0)<<1;
+}
+
+static int hasfun(const char *cp)
+{
+	int c, n = 0;
+	while(c = *cp++)
+	{
+		if(c=='(' && n && isaname(n))
+			return 1;
+		n = c;
+	}
+	return 0;
+}
+
+/*
+ * return the cache entry holding the code compiled for expression str,
+ * compiling it if needed, or NULL if it cannot be cached
+ */
+static struct acache *arith_lookup(const char *str, int mode)
+{
+	struct acache	*ap;
+	struct checkpt	buff;
+	Stk_t		*savstk;
+	size_t		len;
+	unsigned long	hash;
+	char		*last;
+	int		jmpval, options = arith_options();
+	if(sh_isoption(SH_NOEXEC) || hasfun(str))
+		return NULL;
+	len = strlen(str);
+	hash = memsum(str,len,0);
+	ap = &acache[hash%ACACHE];
+	if(ap->ep && ap->hash==hash && ap->len==len && ap->mode==mode && ap->options==options
+	&& ap->radix==sh.radixpoint && memcmp(ap->text,str,len)==0)
+		return ap;
+	if(ap->busy)
+		return NULL;
+	if(ap->stk)
+		stkclose(ap->stk);
+	ap->stk = NULL;
+	ap->ep = NULL;
+	savstk = sh.stk;
+	sh.stk = stkopen(STK_SMALL);
+	sh_pushcontext(&buff,1);
+	jmpval = sigsetjmp(buff.buff,0);
+	if(jmpval==0)
+	{
+		ap->text = stkcopy(sh.stk,str);
+		ap->ep = arith_compile(ap->text,&last,arith,ARITH_COMP|mode);
+	}
+	sh_popcontext(&buff);
+	ap->stk = sh.stk;
+	sh.stk = savstk;
+	if(jmpval || !ap->ep)
+	{
+		/* let arith_strval() report the error */
+		stkclose(ap->stk);
+		ap->stk = NULL;
+		ap->ep = NULL;
+		if(jmpval)
+			siglongjmp(*sh.jmplist,jmpval);
+		return NULL;
+	}
+	ap->hash = hash;
+	ap->len = len;
+	ap->used = last - ap->text;
+	ap->mode = mode;
+	ap->options = options;
+	ap->radix = sh.radixpoint;
+	return ap;
+}
+
+/*
+ * like arith_strval(str,end,arith,mode), but reuses the code compiled for an earlier identical expression
+ */
+static Sfdouble_t arith_cached(const char *str, char **end, int mode)
+{
+	struct acache	*ap;
+	struct checkpt	buff;
+	Sfdouble_t	d = 0;
+	char		*sp;
+	int		offset, jmpval;
+	/* as in arith_strval(), terminate and keep a string still being built on sh.stk, which may be str */
+	if(offset = stktell(sh.stk))
+		sp = stkfreeze(sh.stk,1);
+	else
+		sp = stkptr(sh.stk,0);
+	if(ap = arith_lookup(str,mode))
+	{
+		/* an arithmetic error longjmps out; the entry must not stay busy */
+		ap->busy++;
+		sh_pushcontext(&buff,1);
+		jmpval = sigsetjmp(buff.buff,0);
+		if(jmpval==0)
+			d = arith_exec(ap->ep);
+		sh_popcontext(&buff);
+		ap->busy--;
+		if(jmpval)
+			siglongjmp(*sh.jmplist,jmpval);
+		*end = (char*)str + ap->used;
+	}
+	else
+		d = arith_strval(str,end,arith,mode);
+	stkset(sh.stk,sp,offset);
+	return d;
+}
+
 /*
  * convert number defined by string to a Sfdouble_t
  * ptr is set to the last character processed
@@ -603,7 +737,7 @@ Sfdouble_t sh_strnum(const char *str, char** ptr, int mode)
 			else
 			{
 				if(!last || *last!=sh.radixpoint || last[1]!=sh.radixpoint)
-					d = arith_strval(str,&last,arith,mode);
+					d = arith_cached(str,&last,mode);
 				if(!ptr && *last && mode>0)
 				{
 					errormsg(SH_DICT,ERROR_exit(1),e_lexbadchar,*last,str);
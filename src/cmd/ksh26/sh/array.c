@@ -43,6 +43,9 @@
 #define NV_CHILD		NV_EXPORT
 #define ARRAY_CHILD		1
 #define ARRAY_NOFREE		2
+#define array_touch(ap)		((ap)->cur>=(ap)->last?((ap)->last=(ap)->cur+1):0)
+#define NUM_SHIFT		10	/* log2 of the numbers in a block */
+#define NUM_MASK		((1<<NUM_SHIFT)-1)
 
 struct index_array
 {
@@ -50,6 +53,10 @@ struct index_array
 	void		*xp;		/* if set, subscripts will be converted */
 	int		cur;    	/* index of current element */
 	int		maxi;   	/* maximum index for array */
+	int		last;		/* no element is set at or above this index */
+	int		numsize;	/* size of each packed number */
+	int		nnum;		/* number of entries in num */
+	char		**num;		/* blocks of packed numbers */
 	unsigned char	*bits;		/* bit array for child subscripts */
 	void		*val[1];	/* array of value holders */
 };
@@ -81,6 +88,66 @@ struct assoc_array
    static void array_fixed_setdata(Namval_t*,Namarr_t*,struct fixed_array*);
 #endif /* SHOPT_FIXEDARRAY */
 
+/*
+ * Numbers in an indexed array with a numeric attribute are not allocated one
+ * by one but packed into blocks of 1<<NUM_SHIFT, one block per range of
+ * indices, sized for the first number stored. An element value is packed
+ * exactly when it points to its own slot, so packed values are never freed
+ * individually; the blocks go when the array does.
+ * Return the slot for a number of <size> bytes at index <i> of <ap>, or NULL
+ * if it would not fit.
+ */
+static void *array_numslot(struct index_array *ap, int i, size_t size)
+{
+	int n = i>>NUM_SHIFT;
+	if(!ap->num)
+		ap->numsize = (int)size;
+	else if(size > (size_t)ap->numsize)
+		return NULL;
+	if(n >= ap->nnum)
+	{
+		int m = ap->nnum;
+		ap->nnum = n < 2*m ? 2*m : n+1;
+		ap->num = (char**)sh_realloc(ap->num,ap->nnum*sizeof(char*));
+		memset(&ap->num[m], 0, (ap->nnum-m)*sizeof(char*));
+	}
+	if(!ap->num[n])
+		ap->num[n] = (char*)sh_malloc((size_t)ap->numsize<<NUM_SHIFT);
+	return ap->num[n] + (i&NUM_MASK)*ap->numsize;
+}
+
+/*
+ * return 1 if the value at index <i> of <ap> is packed
+ */
+static int array_packed(struct index_array *ap, int i)
+{
+	int n = i>>NUM_SHIFT;
+	return n < ap->nnum && ap->num[n] && (char*)ap->val[i]==ap->num[n]+(i&NUM_MASK)*ap->numsize;
+}
+
+static void array_numfree(struct index_array *ap)
+{
+	int n;
+	for(n=0; n < ap->nnum; n++)
+		free(ap->num[n]);
+	free(ap->num);
+	ap->num = NULL;
+	ap->nnum = 0;
+}
+
+/*
+ * return storage for a number of <size> bytes to be stored at <vpp> for <np>
+ */
+void *nv_arraynum(Namval_t *np, void **vpp, size_t size)
+{
+	struct index_array *ap;
+	void *vp;
+	if(nv_isattr(np,NV_ARRAY) && (ap = (struct index_array*)nv_arrayptr(np)) && !is_associative(ap) && !ap->header.fixed
+	&& vpp==&ap->val[ap->cur] && (vp = array_numslot(ap,ap->cur,size)))
+		return vp;
+	return sh_malloc(size);
+}
+
 static Namarr_t *array_scope(Namarr_t *ap, int flags)
 {
 	Namarr_t *aq;
@@ -97,7 +164,7 @@ static Namarr_t *array_scope(Namarr_t *ap, int flags)
 	aq->hdr.nofree |= (flags&NV_RDONLY)?1:0;
 	if(is_associative(aq))
 	{
-		aq->scope = dtopen(&_Nvdisc,Dtoset);
+		aq->scope = dtopen(&_Nvdisc,Dtohash);
 		dtview((Dt_t*)aq->scope,aq->table);
 		aq->table = (Dt_t*)aq->scope;
 		return aq;
@@ -116,6 +183,8 @@ static Namarr_t *array_scope(Namarr_t *ap, int flags)
 #endif /* SHOPT_FIXEDARRAY */
 	aq->scope = ap;
 	ar = (struct index_array*)aq;
+	ar->num = NULL;
+	ar->nnum = 0;
 	memset(ar->val, 0, ar->maxi*sizeof(char*));
 	ar->bits =  (unsigned char*)&ar->val[ar->maxi];
 	return aq;
@@ -129,7 +198,11 @@ static int array_unscope(Namval_t *np,Namarr_t *ap)
 	if(is_associative(ap))
 		(*ap->fun)(np, NULL, NV_AFREE);
 	if((fp = nv_disc(np,(Namfun_t*)ap,NV_POP)) && !(fp->nofree&1))
+	{
+		if(!is_associative(ap) && !ap->fixed)
+			array_numfree((struct index_array*)ap);
 		free(fp);
+	}
 	nv_delete(np,NULL,0);
 	return 1;
 }
@@ -152,17 +225,29 @@ static int array_covered(struct index_array *ap)
 }
 
 /*
- * replace discipline with new one
+ * return the pointer to the discipline <ap> in the discipline list of <np>
  */
-static void array_setptr(Namval_t *np, struct index_array *old, struct index_array *new)
+static Namfun_t **array_slot(Namval_t *np, struct index_array *ap)
 {
 	Namfun_t **fp = &np->nvfun;
-	while(*fp && *fp!= &old->header.hdr)
+	while(*fp && *fp!= &ap->header.hdr)
 		fp = &((*fp)->next);
 	if(!*fp)
 		abort();
-	new->header.hdr.next = (*fp)->next;
-	*fp = &new->header.hdr;
+	return fp;
+}
+
+/*
+ * return one more than the highest index that may be set in <ap>
+ * or in the array it is a scope for
+ */
+static int array_top(struct index_array *ap)
+{
+	struct index_array *aq = (struct index_array*)ap->header.scope;
+	int top = ap->last;
+	if(aq && !ap->header.fun && aq->last > top)
+		top = aq->last;
+	return top<ap->maxi ? top : ap->maxi;
 }
 
 /*
@@ -186,9 +271,10 @@ static struct index_array *array_grow(Namval_t*, struct index_array*,int);
 int array_maxindex(Namval_t *np)
 {
 	struct index_array *ap = (struct index_array*)nv_arrayptr(np);
-	int i = ap->maxi;
+	int i;
 	if(is_associative(ap))
 		return -1;
+	i = ap->last;
 	while(i>0 && !ap->val[--i]);
 	return i+1;
 }
@@ -234,8 +320,9 @@ static void **array_getup(Namval_t *np, Namarr_t *arp, int update)
 			errormsg(SH_DICT,ERROR_exit(1),e_subscript,nv_name(np));
 			UNREACHABLE();
 		}
+		array_touch(ap);
 		vpp = &(ap->val[ap->cur]);
-		nofree = array_isbit(ap->bits,ap->cur,ARRAY_NOFREE);
+		nofree = array_isbit(ap->bits,ap->cur,ARRAY_NOFREE) || array_packed(ap,ap->cur);
 	}
 	if(update)
 	{
@@ -375,12 +462,13 @@ static Namval_t *array_find(Namval_t *np,Namarr_t *arp, int flag)
 			errormsg(SH_DICT,ERROR_exit(1),e_subscript,nv_name(np));
 			UNREACHABLE();
 		}
+		array_touch(ap);
 		vpp = &(ap->val[ap->cur]);
 		if((!*vpp || *vpp==Empty) && nv_type(np) && nv_isvtree(np))
 		{
 			char *cp;
 			if(!ap->header.table)
-				ap->header.table = dtopen(&_Nvdisc,Dtoset);
+				ap->header.table = dtopen(&_Nvdisc,Dtohash);
 			sfprintf(sh.strbuf,"%d",ap->cur);
 			cp = sfstruse(sh.strbuf);
 			mp = nv_search(cp, ap->header.table, NV_ADD);
@@ -415,7 +503,7 @@ int nv_arraysettype(Namval_t *np, Namval_t *tp, const char *sub, int flags)
 	Namarr_t	*ap = nv_arrayptr(np);
 	sh.last_table = 0;
 	if(!ap->table)
-		ap->table = dtopen(&_Nvdisc,Dtoset);
+		ap->table = dtopen(&_Nvdisc,Dtohash);
 	if(nq = nv_search(sub, ap->table, NV_ADD))
 	{
 		char	*saved_value = NULL;
@@ -476,7 +564,7 @@ static Namfun_t *array_clone(Namval_t *np, Namval_t *mp, int flags, Namfun_t *fp
 	}
 	if(ap->table)
 	{
-		ap->table = dtopen(&_Nvdisc,Dtoset);
+		ap->table = dtopen(&_Nvdisc,Dtohash);
 		if(ap->scope && !(flags&NV_COMVAR))
 		{
 			ap->scope = ap->table;
@@ -490,7 +578,11 @@ static Namfun_t *array_clone(Namval_t *np, Namval_t *mp, int flags, Namfun_t *fp
 		sub = sh_strdup(sub);
 	ar = (struct index_array*)ap;
 	if(!is_associative(ap))
+	{
 		ar->bits = (unsigned char*)&ar->val[ar->maxi];
+		ar->num = NULL;
+		ar->nnum = 0;
+	}
 	if(!nv_putsub(np,NULL,ARRAY_SCAN|((flags&NV_COMVAR)?0:ARRAY_NOSCOPE)))
 	{
 		if(ap->fun)
@@ -514,7 +606,9 @@ static Namfun_t *array_clone(Namval_t *np, Namval_t *mp, int flags, Namfun_t *fp
 		}
 		else if(flags&NV_ARRAY)
 		{
-			if((flags&NV_NOFREE) && !is_associative(ap))
+			if(!is_associative(ap) && array_packed(aq,aq->cur))
+				ar->val[ar->cur] = memcpy(array_numslot(ar,ar->cur,aq->numsize),aq->val[aq->cur],aq->numsize);
+			else if((flags&NV_NOFREE) && !is_associative(ap))
 				array_setbit(aq->bits,aq->cur,ARRAY_NOFREE);
 			else if(nq && (flags&NV_NOFREE))
 			{
@@ -589,6 +683,43 @@ static Sfdouble_t array_getnum(Namval_t *np, Namfun_t *disc)
 	return nv_getn(np,&ap->hdr);
 }
 
+/*
+ * Unset a whole associative array of plain values by freeing its elements
+ * in a single pass over the table, without first putting them in order as
+ * a scan would. Returns 0 if the elements have to be deleted one at a time
+ * instead, as compound or array elements need the table to find their parts.
+ */
+static int array_freeall(Namval_t *np, Namarr_t *ap)
+{
+	struct assoc_array	*aq = (struct assoc_array*)ap;
+	Dtlink_t		*list, *lp, *lpnext;
+	Namval_t		*mp;
+	if(ap->fun!=nv_associative || ap->scope || ap->hdr.type || sh.subshell || !(ap->nelem&ARRAY_UNDEF))
+		return 0;
+	list = dtextract(ap->table);
+	for(lp = list; lp; lp = dtlink(ap->table,lp))
+	{
+		if(((Namval_t*)dtobj(ap->table,lp))->nvfun)
+		{
+			dtrestore(ap->table,list);
+			return 0;
+		}
+	}
+	for(lp = list; lp; lp = lpnext)
+	{
+		lpnext = dtlink(ap->table,lp);
+		mp = (Namval_t*)dtobj(ap->table,lp);
+		nv_unset(mp,NV_RDONLY);
+		nv_delete(mp,NULL,0);
+		nv_freenode(mp);
+	}
+	aq->pos = aq->nextpos = aq->cur = NULL;
+	ap->nelem &= ~(ARRAY_MASK|ARRAY_UNDEF);
+	(*ap->fun)(np,NULL,NV_AFREE);
+	nv_offattr(np,NV_ARRAY);
+	return 1;
+}
+
 static void array_putval(Namval_t *np, const char *string, int flags, Namfun_t *dp)
 {
 	Namarr_t	*ap = (Namarr_t*)dp;
@@ -599,6 +730,8 @@ static void array_putval(Namval_t *np, const char *string, int flags, Namfun_t *
 #if SHOPT_FIXEDARRAY
 	struct fixed_array	*fp;
 #endif /* SHOPT_FIXEDARRAY */
+	if(!string && is_associative(ap) && array_freeall(np,ap))
+		goto freed;
 	do
 	{
 		int xfree = (ap->fixed||is_associative(ap))?0:array_isbit(aq->bits,aq->cur,ARRAY_NOFREE);
@@ -713,6 +846,7 @@ static void array_putval(Namval_t *np, const char *string, int flags, Namfun_t *
 			nv_arraysettype(np,ap->hdr.type,nv_getsub(np),0);
 	}
 	while(!string && nv_nextsub(np));
+freed:
 	if(ap)
 		ap->nelem &= ~ARRAY_NOSCOPE;
 	if(nofree)
@@ -751,6 +885,8 @@ static void array_putval(Namval_t *np, const char *string, int flags, Namfun_t *
 		}
 		if((nfp = nv_disc(np,(Namfun_t*)ap,NV_POP)) && !(nfp->nofree&1))
 		{
+			if(!is_associative(ap) && !ap->fixed)
+				array_numfree(aq);
 			ap = 0;
 			free(nfp);
 		}
@@ -800,6 +936,9 @@ static void array_copytree(Namval_t *np, Namval_t *mp)
  *        of the required size is allocated.  A pointer to the
  *        allocated Namarr_t structure is returned.
  *        <maxi> becomes the current index of the array.
+ *        An existing array is resized in place where realloc(3) can;
+ *        as arsize() at least doubles it, growing an array one element
+ *        at a time copies each element a constant number of times.
  */
 static struct index_array *array_grow(Namval_t *np, struct index_array *arp,int maxi)
 {
@@ -812,26 +951,30 @@ static struct index_array *array_grow(Namval_t *np, struct index_array *arp,int
 		UNREACHABLE();
 	}
 	i = (newsize - 1) * sizeof(void*) + newsize;
+	if(arp)
+	{
+		Namfun_t **fp = array_slot(np,arp);
+		int oldsize = arp->maxi;
+		ap = (struct index_array*)sh_realloc(arp,sizeof(*ap)+i);
+		/* the child bits follow the values; move them past the new values */
+		memmove(&ap->val[newsize], &ap->val[oldsize], oldsize);
+		memset(&ap->val[oldsize], 0, (newsize-oldsize)*sizeof(void*));
+		ap->bits = (unsigned char*)&ap->val[newsize];
+		memset(ap->bits+oldsize, 0, newsize-oldsize);
+		ap->maxi = newsize;
+		ap->cur = maxi;
+		array_touch(ap);
+		ap->header.hdr.dsize = sizeof(*ap) + i;
+		*fp = &ap->header.hdr;
+		return ap;
+	}
 	ap = new_of(struct index_array,i);
 	memset(ap,0,sizeof(*ap)+i);
 	ap->maxi = newsize;
 	ap->cur = maxi;
+	ap->last = maxi+1;
 	ap->bits =  (unsigned char*)&ap->val[newsize];
 	memset(ap->bits, 0, newsize);
-	if(arp)
-	{
-		ap->header = arp->header;
-		ap->header.hdr.dsize = sizeof(*ap) + i;
-		for(i=0;i < arp->maxi;i++)
-		{
-			ap->bits[i] = arp->bits[i];
-			ap->val[i] = arp->val[i];
-		}
-		memcpy(ap->bits, arp->bits, arp->maxi);
-		array_setptr(np,arp,ap);
-		free(arp);
-	}
-	else
 	{
 		Namval_t *mp=0;
 		ap->header.hdr.dsize = sizeof(*ap) + i;
@@ -846,7 +989,7 @@ static struct index_array *array_grow(Namval_t *np, struct index_array *arp,int
 			np->nvalue = NULL;
 		if(nv_hasdisc(np,&array_disc) || (nv_type(np) && nv_isvtree(np)))
 		{
-			ap->header.table = dtopen(&_Nvdisc,Dtoset);
+			ap->header.table = dtopen(&_Nvdisc,Dtohash);
 			mp = nv_search("0", ap->header.table,NV_ADD);
 			if(mp && nv_isnull(mp))
 			{
@@ -949,11 +1092,15 @@ static Namarr_t *nv_changearray(Namval_t *np, void *(*fun)(Namval_t*,const char*
 			}
 			nv_putsub(np, string_index, ARRAY_ADD);
 			vpp = (void**)((*ap->fun)(np,NULL,0));
-			*vpp = save_ap->val[dot];
+			if(array_packed(save_ap,dot))
+				*vpp = memcpy(sh_malloc(save_ap->numsize),save_ap->val[dot],save_ap->numsize);
+			else
+				*vpp = save_ap->val[dot];
 			save_ap->val[dot] = NULL;
 		}
 		string_index = &numbuff[NUMSIZE];
 	}
+	array_numfree(save_ap);
 	free(save_ap);
 	return ap;
 }
@@ -1061,7 +1208,7 @@ Namval_t *nv_arraychild(Namval_t *np, Namval_t *nq, int c)
 int nv_nextsub(Namval_t *np)
 {
 	struct index_array	*ap = (struct index_array*)nv_arrayptr(np);
-	unsigned		dot;
+	unsigned		dot, top;
 	struct index_array	*aq=0, *ar=0;
 #if SHOPT_FIXEDARRAY
 	struct fixed_array	*fp;
@@ -1112,7 +1259,8 @@ int nv_nextsub(Namval_t *np)
 #endif /* SHOPT_FIXEDARRAY */
 	if(!(ap->header.nelem&ARRAY_NOSCOPE))
 		ar = (struct index_array*)ap->header.scope;
-	for(dot=ap->cur+1; dot <  (unsigned)ap->maxi; dot++)
+	top = array_top(ap);
+	for(dot=ap->cur+1; dot < top; dot++)
 	{
 		aq = ap;
 		if(!ap->val[dot] && !(ap->header.nelem&ARRAY_NOSCOPE))
@@ -1123,12 +1271,14 @@ int nv_nextsub(Namval_t *np)
 		if(aq->val[dot]==Empty && array_elem(&aq->header) < nv_aimax(np)+1)
 		{
 			ap->cur = dot;
+			array_touch(ap);
 			if(nv_getval(np)==Empty)
 				continue;
 		}
 		if(aq->val[dot])
 		{
 			ap->cur = dot;
+			array_touch(ap);
 			if(array_isbit(aq->bits, dot,ARRAY_CHILD))
 			{
 				Namval_t *mp = aq->val[dot];
@@ -1201,6 +1351,7 @@ Namval_t *nv_putsub(Namval_t *np,char *sp,long mode)
 		ap->header.nelem &= ~ARRAY_UNDEF;
 		ap->header.nelem |= (mode&(ARRAY_SCAN|ARRAY_NOCHILD|ARRAY_UNDEF|ARRAY_NOSCOPE));
 		ap->cur = size;
+		array_touch(ap);
 		if((mode&ARRAY_SCAN) && (ap->cur--,!nv_nextsub(np)))
 			np = 0;
 		if(mode&(ARRAY_FILL|ARRAY_ADD))
@@ -1233,7 +1384,7 @@ Namval_t *nv_putsub(Namval_t *np,char *sp,long mode)
 					char *cp;
 					Namval_t *mp;
 					if(!ap->header.table)
-						ap->header.table = dtopen(&_Nvdisc,Dtoset);
+						ap->header.table = dtopen(&_Nvdisc,Dtohash);
 					sfprintf(sh.strbuf,"%d",ap->cur);
 					cp = sfstruse(sh.strbuf);
 					mp = nv_search(cp, ap->header.table, NV_ADD);
@@ -1639,7 +1790,7 @@ int nv_aimax(Namval_t* np)
 	if(!ap || is_associative(&ap->header))
 #endif /* SHOPT_FIXEDARRAY */
 		return -1;
-	sub = ap->maxi;
+	sub = ap->last;
 	while(--sub>0 && !ap->val[sub]);
 	return sub;
 }
@@ -1655,7 +1806,7 @@ void *nv_associative(Namval_t *np,const char *sp,int mode)
 	{
 	    case NV_AINIT:
 		ap = (struct assoc_array*)sh_calloc(1,sizeof(struct assoc_array));
-		ap->header.table = dtopen(&_Nvdisc,Dtoset);
+		ap->header.table = dtopen(&_Nvdisc,Dtohash);
 		ap->cur = 0;
 		ap->pos = 0;
 		ap->header.hdr.disc = &array_disc;
@@ -1816,7 +1967,7 @@ void nv_setvec(Namval_t *np,int append,int argc,char *argv[])
 		{
 			if(!(aq = (struct index_array*)ap->header.scope))
 				aq = ap;
-			arg0 = ap->maxi;
+			arg0 = array_top(ap);
 			while(--arg0>0 && !ap->val[arg0] && !aq->val[arg0]);
 			arg0++;
 		}
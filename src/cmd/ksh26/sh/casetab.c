@@ -0,0 +1,234 @@
+/***********************************************************************
+*                                                                      *
+*               This software is part of the ast package               *
+*          Copyright (c) 2020-2026 Contributors to ksh 93u+m           *
+*                      and is licensed under the                       *
+*                 Eclipse Public License, Version 2.0                  *
+*                                                                      *
+*                A copy of the License is available at                 *
+*      https://www.eclipse.org/org/documents/epl-2.0/EPL-2.0.html      *
+*         (with md5 checksum 84283fa8859daf213bdda5a9f8d1be1d)         *
+*                                                                      *
+***********************************************************************/
+/*
+ * Dispatch tables for case statements
+ *
+ * When a case statement is parsed or restored, its patterns are sorted
+ * into kinds that can be tested without the regex engine: literals (quoted
+ * patterns or ones without pattern characters) go into a hash table, and
+ * '*', 'lit*', '*lit' and '*lit*' become plain string comparisons. Other
+ * patterns are matched with strmatch() as before, and patterns that need
+ * expanding are still expanded only when they are reached, so the order of
+ * any side effects is unchanged. The table lives on the same stack as the
+ * parse tree and is freed along with it.
+ */
+
+#include	"shopt.h"
+#include	"defs.h"
+#include	"shnodes.h"
+
+#define SW_LIT	0		/* literal string */
+#define SW_ANY	1		/* * */
+#define SW_PRE	2		/* lit* */
+#define SW_SUF	3		/* *lit */
+#define SW_SUB	4		/* *lit* */
+#define SW_PAT	5		/* any other pattern */
+#define SW_MAC	6		/* pattern to be expanded */
+
+struct swpat
+{
+	struct argnod	*arg;
+	const char	*str;		/* the literal part */
+	int		len;		/* its length */
+	int		arm;		/* index of the arm */
+	int		next;		/* next SW_LIT with the same string, or -1 */
+	int		kind;
+};
+
+/* characters that are not taken literally in a pattern */
+static const char	patchars[] = "*?[]\\()|&!@+{}~^%";
+
+/*
+ * return the number of literal characters at <cp>
+ */
+static int litlen(const char *cp)
+{
+	const char *sp = cp;
+	while(*sp && !strchr(patchars,*sp))
+		sp++;
+	return sp - cp;
+}
+
+static void classify(struct swpat *pp)
+{
+	char	*cp = pp->arg->argval;
+	int	n;
+	pp->str = cp;
+	pp->len = strlen(cp);
+	pp->kind = SW_LIT;
+	if(pp->arg->argflag&ARG_MAC)
+		pp->kind = SW_MAC;
+	else if(pp->arg->argflag&ARG_RAW)
+		;
+	else if(litlen(cp)==pp->len)
+		;
+	else if(*cp=='*' && cp[1]==0)
+		pp->kind = SW_ANY;
+	else if(*cp!='*' && (n = litlen(cp))==pp->len-1 && cp[n]=='*')
+	{
+		pp->kind = SW_PRE;
+		pp->len = n;
+	}
+	else if(*cp=='*' && (n = litlen(cp+1))>0 && (cp[n+1]==0 || cp[n+1]=='*' && cp[n+2]==0))
+	{
+		pp->kind = cp[n+1] ? SW_SUB : SW_SUF;
+		pp->str = cp+1;
+		pp->len = n;
+		if(pp->kind==SW_SUB)
+		{
+			char *sp = stkalloc(sh.stk,n+1);
+			memcpy(sp,cp+1,n);
+			sp[n] = 0;
+			pp->str = sp;
+		}
+	}
+	else
+		pp->kind = SW_PAT;
+}
+
+/*
+ * compile the patterns of case statement <sw> into a dispatch table
+ */
+void sh_casecomp(struct swnod *sw)
+{
+	struct swtab	*tp;
+	struct swpat	*pp;
+	struct regnod	*reg;
+	struct argnod	*ap;
+	int		narm=0, npat=0, nlit=0, i, j;
+	unsigned int	h;
+	sw->swtab = NULL;
+	for(reg=sw->swlst; reg; reg=reg->regnxt, narm++)
+		for(ap=reg->regptr; ap; ap=ap->argnxt.ap)
+			npat++;
+	if(!narm)
+		return;
+	tp = stkalloc(sh.stk,sizeof(struct swtab));
+	tp->arm = stkalloc(sh.stk,narm*sizeof(struct regnod*));
+	tp->first = stkalloc(sh.stk,(narm+1)*sizeof(int));
+	tp->pat = pp = stkalloc(sh.stk,npat*sizeof(struct swpat));
+	tp->narm = narm;
+	tp->npat = npat;
+	for(i=0, reg=sw->swlst; reg; reg=reg->regnxt, i++)
+	{
+		tp->arm[i] = reg;
+		tp->first[i] = pp - tp->pat;
+		for(ap=reg->regptr; ap; ap=ap->argnxt.ap, pp++)
+		{
+			pp->arg = ap;
+			pp->arm = i;
+			pp->next = -1;
+			classify(pp);
+			if(pp->kind==SW_LIT)
+				nlit++;
+		}
+	}
+	tp->first[narm] = npat;
+	tp->mask = 0;
+	tp->hash = NULL;
+	if(nlit)
+	{
+		for(h=4; h < 2*nlit; h <<= 1);
+		tp->mask = h-1;
+		tp->hash = stkalloc(sh.stk,h*sizeof(int));
+		memset(tp->hash,0,h*sizeof(int));
+		for(i=0, pp=tp->pat; i < npat; i++, pp++)
+		{
+			if(pp->kind!=SW_LIT)
+				continue;
+			h = dtstrhash(0,(void*)pp->str,pp->len) & tp->mask;
+			while(j = tp->hash[h])
+			{
+				struct swpat *qp = &tp->pat[j-1];
+				if(qp->len==pp->len && memcmp(qp->str,pp->str,pp->len)==0)
+				{
+					/* the same literal in a later arm, for ;;& */
+					while(qp->next>=0)
+						qp = &tp->pat[qp->next];
+					qp->next = i;
+					break;
+				}
+				h = (h+1) & tp->mask;
+			}
+			if(!j)
+				tp->hash[h] = i+1;
+		}
+	}
+	sw->swtab = tp;
+}
+
+/*
+ * return the index of the first arm at or after <arm> with a pattern that
+ * matches <word>, or -1 if there is none
+ */
+int sh_casematch(const struct swtab *tp, int arm, const char *word, int flags)
+{
+	const struct swpat	*pp;
+	size_t			len = strlen(word);
+	int			lit = tp->npat, i;
+	unsigned int		h;
+	/* find the first literal that matches, then try the other patterns before it in order */
+	if(tp->mask)
+	{
+		h = dtstrhash(0,(void*)word,len) & tp->mask;
+		while(i = tp->hash[h])
+		{
+			pp = &tp->pat[i-1];
+			if(pp->len==len && memcmp(pp->str,word,len)==0)
+			{
+				while(pp->arm < arm && pp->next>=0)
+					pp = &tp->pat[pp->next];
+				if(pp->arm >= arm)
+					lit = pp - tp->pat;
+				break;
+			}
+			h = (h+1) & tp->mask;
+		}
+	}
+	for(i=tp->first[arm]; i < lit; i++)
+	{
+		pp = &tp->pat[i];
+		switch(pp->kind)
+		{
+		    case SW_LIT:
+			continue;
+		    case SW_ANY:
+			break;
+		    case SW_PRE:
+			if(len<pp->len || memcmp(word,pp->str,pp->len))
+				continue;
+			break;
+		    case SW_SUF:
+		    case SW_SUB:
+			/* a byte match may be inside a character unless the locale is UTF-8 */
+			if(mbwide() && !(ast.locale.set&AST_LC_utf8))
+			{
+				if(!strmatch(word,pp->arg->argval))
+					continue;
+			}
+			else if(pp->kind==SW_SUF ? (len<pp->len || memcmp(word+len-pp->len,pp->str,pp->len)) : !strstr(word,pp->str))
+				continue;
+			break;
+		    case SW_PAT:
+			if(!strmatch(word,pp->str))
+				continue;
+			break;
+		    default:
+			if(!strmatch(word,sh_macpat(pp->arg,(flags&ARG_OPTIMIZE)|ARG_EXP)))
+				continue;
+			break;
+		}
+		return pp->arm;
+	}
+	return lit < tp->npat ? tp->pat[lit].arm : -1;
+}
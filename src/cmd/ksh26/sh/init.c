@@ -402,6 +402,7 @@ static void put_restricted(Namval_t *np,const char *val,int flags,Namfun_t *fp)
 		sh.pathlist = path_unsetfpath();
 	nv_putv(np, val, flags, fp);
 	sh.universe = 0;
+	sh_cmdchanged();
 	if(sh.pathlist)
 	{
 		val = np->nvalue;
@@ -1416,11 +1417,7 @@ void sh_reinit(void)
 #endif
 	sh.options = opt;
 	/* Reset here-document */
-	if(sh.heredocs)
-	{
-		sfclose(sh.heredocs);
-		sh.heredocs = 0;
-	}
+	sh_ioheredocclose();
 	/* Reset arguments */
 	if(sh.arglist)
 		sh_argreset(sh.arglist,NULL);
@@ -1667,6 +1664,15 @@ static void stat_init(void)
 		nv_setsize(np,10);
 		np->nvalue = &sh.stats[i];
 	}
+	/* node accounting is kept by the node allocator */
+	nv_nodestats(nv_namptr(sp->nodes,STAT_NVNODES),nv_namptr(sp->nodes,STAT_NVBYTES));
+	/* and pattern cache accounting by regcache() */
+	np = nv_namptr(sp->nodes,STAT_REHITS);
+	np->nvalue = &regcachestat()->rc_hits;
+	np = nv_namptr(sp->nodes,STAT_REMISSES);
+	np->nvalue = &regcachestat()->rc_misses;
+	np = nv_namptr(sp->nodes,STAT_REEVICT);
+	np->nvalue = &regcachestat()->rc_evictions;
 	sp->hdr.dsize = sizeof(struct Stats) + extrasize;
 	sp->hdr.disc = &stat_disc;
 	nv_stack(SH_STATS,&sp->hdr);
@@ -1780,12 +1786,13 @@ static Init_t *nv_init(void)
 	MCHKNOD->nvalue = &sh_mailchk;
 	OPTINDNOD->nvalue = &sh.st.optindex;
 	SH_LEVELNOD->nvalue = &sh.level;
-	sh.alias_tree = dtopen(&_Nvdisc,Dtoset);
+	sh.alias_tree = dtopen(&_Nvdisc,Dtohash);
 	sh.track_tree = dtopen(&_Nvdisc,Dtset);
 	sh.bltin_tree = sh_inittree((const struct shtable2*)shtab_builtins);
-	sh.fun_base = sh.fun_tree = dtopen(&_Nvdisc,Dtoset);
+	sh.fun_base = sh.fun_tree = dtopen(&_Nvdisc,Dtohash);
 	dtview(sh.fun_tree,sh.bltin_tree);
-	nv_mount(DOTSHNOD, "type", sh.typedict=dtopen(&_Nvdisc,Dtoset));
+	sh_cmdchanged();
+	nv_mount(DOTSHNOD, "type", sh.typedict=dtopen(&_Nvdisc,Dtohash));
 	DOTSHNOD->nvalue = Empty;
 	nv_onattr(DOTSHNOD,NV_RDONLY);
 	SH_LINENO->nvalue = &sh.st.lineno;
@@ -1825,7 +1832,7 @@ Dt_t *sh_inittree(const struct shtable2 *name_vals)
 	}
 	else if(name_vals==(const struct shtable2*)shtab_builtins)
 		sh.bltin_cmds = np;
-	base_treep = treep = dtopen(&_Nvdisc,Dtoset);
+	base_treep = treep = dtopen(&_Nvdisc,Dtohash);
 	for(tp=name_vals;*tp->sh_name;tp++,np++)
 	{
 		if((np->nvname = strrchr(tp->sh_name,'.')) && np->nvname!=((char*)tp->sh_name))
@@ -1846,7 +1853,7 @@ Dt_t *sh_inittree(const struct shtable2 *name_vals)
 		}
 		nv_setattr(np,tp->sh_number);
 		if(nv_isattr(np,NV_TABLE))
-			nv_mount(np,NULL,dict=dtopen(&_Nvdisc,Dtoset));
+			nv_mount(np,NULL,dict=dtopen(&_Nvdisc,Dtohash));
 		if(nv_isattr(np,NV_INTEGER))
 			nv_setsize(np,10);
 		else
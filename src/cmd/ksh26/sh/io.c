@@ -75,6 +75,10 @@
 static void	*timeout;
 static int	(*fdnotify)(int,int);
 
+#ifdef __linux__
+#   include <sys/syscall.h>
+#endif
+
 #if defined(_lib_socket) && defined(_sys_socket) && defined(_hdr_netinet_in)
 #   include <sys/socket.h>
 #   include <netdb.h>
@@ -1579,17 +1583,153 @@ fail:
 	UNREACHABLE();
 }
 /*
- * Create a tmp file for the here-document
+ * Bodies of here-documents are read from sh.heredocs under a lock.
+ * That file is only ever appended to, so a body at a given offset
+ * does not change while the file is open; cache small bodies here so
+ * a here-document in a loop is read from the file only once.
+ */
+#define HERE_NCACHE	64		/* number of slots, a power of 2 */
+#define HERE_MAXCACHE	(16*1024)	/* larger bodies are not cached */
+
+static struct Herecache
+{
+	off_t	offset;
+	long	size;
+	char	*body;
+} herecache[HERE_NCACHE];
+
+/*
+ * Close the here-document file and forget the bodies cached from it
+ */
+void sh_ioheredocclose(void)
+{
+	int	i;
+	if(sh.heredocs)
+	{
+		sfclose(sh.heredocs);
+		sh.heredocs = NULL;
+	}
+	for(i=0; i < HERE_NCACHE; i++)
+	{
+		free(herecache[i].body);
+		herecache[i].body = NULL;
+	}
+}
+
+/*
+ * Return the cached body of here-document <iop>, reading it if needed
+ * Returns NULL if the body is too large to cache
+ */
+static char *here_body(struct ionod *iop)
+{
+	struct Herecache	*hp;
+	struct flock		lock;
+	Sfoff_t			off;
+	int			fno;
+	ssize_t			n;
+	if(iop->iosize > HERE_MAXCACHE)
+		return NULL;
+	hp = &herecache[(iop->iooffset ^ iop->iooffset>>7) & (HERE_NCACHE-1)];
+	if(hp->body && hp->offset==iop->iooffset && hp->size==iop->iosize)
+		return hp->body;
+	free(hp->body);
+	hp->body = NULL;
+	/*
+	 * the locking is only needed in case & blocks process
+	 * here-docs so this can be eliminated in some cases
+	 */
+	if((fno = sffileno(sh.heredocs)) >= 0)
+	{
+		memset(&lock,0,sizeof(lock));
+		lock.l_type = F_WRLCK;
+		lock.l_whence = SEEK_SET;
+		fcntl(fno,F_SETLKW,&lock);
+		lock.l_type = F_UNLCK;
+	}
+	off = sftell(sh.heredocs);
+	n = -1;
+	hp->body = sh_malloc(iop->iosize+1);
+	if(sfseek(sh.heredocs,iop->iooffset,SEEK_SET) >= 0)
+		n = sfread(sh.heredocs,hp->body,iop->iosize);
+	sfseek(sh.heredocs,off,SEEK_SET);
+	if(fno >= 0)
+		fcntl(fno,F_SETLK,&lock);
+	if(n != iop->iosize)
+	{
+		free(hp->body);
+		hp->body = NULL;
+		return NULL;
+	}
+	hp->body[n] = 0;
+	hp->offset = iop->iooffset;
+	hp->size = iop->iosize;
+	return hp->body;
+}
+
+/*
+ * Return a memfd to read the <n> bytes at <buf> from, which can seek like a file
+ * so that commands sharing the here-document see the same content as with sftmp()
+ * Returns -1 if <n> is too large or there is no memfd
+ */
+static int here_fd(const char *buf, size_t n)
+{
+#ifdef SYS_memfd_create
+	static char	nomemfd;
+	int		fd;
+	if(n > PIPE_BUF || nomemfd)
+		return -1;
+	if((fd = (int)syscall(SYS_memfd_create,"heredoc",0)) < 0)
+	{
+		if(errno==ENOSYS)
+			nomemfd = 1;
+		return -1;
+	}
+	if(write(fd,buf,n) != n || lseek(fd,0,SEEK_SET) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+	sh.fdstatus[fd] = IOREAD;
+	return fd;
+#else
+	NOT_USED(buf);
+	NOT_USED(n);
+	return -1;
+#endif
+}
+
+/*
+ * Create a descriptor for the here-document
+ * Small bodies are written to a memfd where available, others to a tmp file
  */
 static int io_heredoc(struct ionod *iop, const char *name, int traceon)
 {
 	Sfio_t		*infile = 0, *outfile, *tmp;
 	int		fd;
 	Sfoff_t		off;
+	char		*body = NULL;
 	if(!(iop->iofile&IOSTRG) && (!sh.heredocs || iop->iosize==0))
 		return sh_open(e_devnull,O_RDONLY);
-	/* create an unnamed temporary file */
-	if(!(outfile=sftmp(0)))
+	if(iop->iofile&IOSTRG)
+	{
+		size_t	n = strlen(name);
+		if(!traceon && n < PIPE_BUF)
+		{
+			char	buf[PIPE_BUF];
+			memcpy(buf,name,n);
+			buf[n++] = '\n';
+			if((fd = here_fd(buf,n)) >= 0)
+				return fd;
+		}
+	}
+	else if(!traceon && (body = here_body(iop)) && (iop->iofile&IOQUOTE))
+	{
+		/* This is a quoted here-document, not expansion */
+		if((fd = here_fd(body,iop->iosize)) >= 0)
+			return fd;
+	}
+	/* create an unnamed temporary file, kept in memory while small */
+	if(!(outfile=sftmp(traceon?0:PIPE_BUF)))
 	{
 		errormsg(SH_DICT,ERROR_system(1),e_tmpcreate);
 		UNREACHABLE();
@@ -1600,6 +1740,20 @@ static int io_heredoc(struct ionod *iop, const char *name, int traceon)
 			sfprintf(sfstderr,"< %s\n",name);
 		sfputr(outfile,name,'\n');
 	}
+	else if(body)
+	{
+		if(iop->iofile&IOQUOTE)
+			sfwrite(outfile,body,iop->iosize);
+		else
+		{
+			/* expansion can evict the cache slot, so use a copy */
+			body = memcpy(sh_malloc(iop->iosize+1),body,iop->iosize+1);
+			infile = sfnew(NULL,body,iop->iosize,-1,SFIO_STRING|SFIO_READ);
+			sh_machere(infile,outfile,iop->ioname);
+			sfclose(infile);
+			free(body);
+		}
+	}
 	else
 	{
 		/*
@@ -1651,6 +1805,25 @@ static int io_heredoc(struct ionod *iop, const char *name, int traceon)
 				sfclose(infile);
 		}
 	}
+	if(!traceon && sffileno(outfile)<0)
+	{
+		/* the result is still in memory */
+		off = sftell(outfile);
+		sfseek(outfile,0,SEEK_SET);
+		fd = -1;
+		if(body = sfreserve(outfile,off,SFIO_LOCKR))
+		{
+			fd = here_fd(body,off);
+			sfread(outfile,body,0);
+		}
+		if(fd >= 0)
+		{
+			sfclose(outfile);
+			return fd;
+		}
+		sfseek(outfile,off,SEEK_SET);
+		sfdisc(outfile,SFIO_POPDISC);
+	}
 	/* close stream outfile, but save file descriptor */
 	fd = sffileno(outfile);
 	sfsetfd(outfile,-1);
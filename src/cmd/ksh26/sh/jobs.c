@@ -56,6 +56,14 @@
 #include	"jobs.h"
 #include	"history.h"
 
+#if defined(__linux__) && _lib_poll
+#   include	<sys/syscall.h>
+#   include	<poll.h>
+#   ifdef SYS_pidfd_open
+#	define _JOB_PIDFD	1	/* wait for specific children on pidfd_open(2) descriptors */
+#   endif
+#endif
+
 #if !defined(WCONTINUED) || !defined(WIFCONTINUED)
 #   undef  WCONTINUED
 #   define WCONTINUED	0
@@ -162,6 +170,9 @@ static char		*job_sigmsg(int);
 static int		job_alloc(void);
 static void		job_free(int);
 static struct process	*job_unpost(struct process*,int);
+static void		job_link(struct process*);
+static void		job_hashpid(struct process*);
+static void		job_unhashpid(struct process*);
 static void		job_unlink(struct process*);
 static void		job_prmsg(struct process*);
 static struct process	*freelist;
@@ -172,6 +183,10 @@ static char		by_number;
 static Sfio_t		*outfile;
 static pid_t		lastpid;
 static struct back_save	bck;
+static struct process	**pidtab;	/* posted processes hashed by process ID */
+static unsigned int	pidmask;	/* size of pidtab minus 1 */
+static struct process	**jobtab;	/* top process of each posted job, indexed by job number */
+static int		jobmax;		/* highest job number that fits in jobtab */
 
 static void		job_set(struct process*);
 static void		job_reset(struct process*);
@@ -354,8 +369,7 @@ int job_reap(int sig)
 			{
 				/* move to top of job list */
 				job_unlink(px);
-				px->p_nxtjob = job.pwlist;
-				job.pwlist = px;
+				job_link(px);
 			}
 			continue;
 		}
@@ -702,10 +716,76 @@ void job_bwait(char **jobs)
 		}
 		else
 			pid = pid_fromstring(jp);
+		if(job_waitany(&pid,1,1) < 0 && sh.trapnote)
+		{
+			/* interrupted by a trap */
+			sh.exitval = 1;
+			exitset();
+			return;
+		}
 		job_wait(-pid);
 	}
 }
 
+/*
+ * wait -n: wait for the first of <jobs>, or of any job if there are none, to terminate
+ * Returns its process ID, or 0 if there was nothing to wait for or a trap interrupted the wait
+ */
+pid_t job_bwaitany(char **jobs)
+{
+	struct process *pw;
+	pid_t *pids;
+	int n;
+	for(n=0; jobs[n]; n++);
+	pids = stkalloc(sh.stk,(n+1)*sizeof(pid_t));
+	for(n=0; jobs[n]; n++)
+	{
+		if(*jobs[n] != '%')
+			pids[n] = pid_fromstring(jobs[n]);
+	}
+	job_lock();
+	if(n)
+	{
+		for(n=0; jobs[n]; n++)
+		{
+			if(*jobs[n] != '%')
+				continue;
+			if(!(pw = job_bystring(jobs[n])))
+			{
+				job_unlock();
+				sh.exitval = ERROR_NOENT;
+				exitset();
+				return 0;
+			}
+			pids[n] = pw->p_pid;
+		}
+	}
+	else
+	{
+		/* all jobs of this shell environment that can still terminate */
+		for(pw=job.pwlist; pw; pw=pw->p_nxtjob)
+		{
+			if(pw->p_env==sh.curenv && !(pw->p_flag&P_STOPPED))
+				n++;
+		}
+		pids = stkalloc(sh.stk,(n+1)*sizeof(pid_t));
+		for(n=0,pw=job.pwlist; pw; pw=pw->p_nxtjob)
+		{
+			if(pw->p_env==sh.curenv && !(pw->p_flag&P_STOPPED))
+				pids[n++] = pw->p_pid;
+		}
+	}
+	job_unlock();
+	if(n==0 || (n = job_waitany(pids,n,1)) < 0)
+	{
+		sh.exitval = n<0 && sh.trapnote ? 1 : ERROR_NOENT;
+		exitset();
+		return 0;
+	}
+	job_wait(-pids[n]);
+	return pids[n];
+}
+
 /*
  * execute function <fun> for each job
  */
@@ -1066,6 +1146,8 @@ void	job_clear(void)
 		init_savelist();
 	job.pwlist = NULL;
 	job.numpost=0;
+	if(pidtab)
+		memset(pidtab,0,(pidmask+1)*sizeof(struct process*));
 #if SHOPT_BGX
 	job.numbjob = 0;
 #endif /* SHOPT_BGX */
@@ -1073,7 +1155,13 @@ void	job_clear(void)
 	job.curpgid = 0;
 	job.toclear = 0;
 	if(!job.freejobs)
+	{
 		job.freejobs = (unsigned char*)sh_malloc((unsigned)(j+1));
+		jobmax = (j+1)*CHAR_BIT;
+		jobtab = sh_newof(0,struct process*,jobmax+1,0);
+	}
+	else
+		memset(jobtab,0,(jobmax+1)*sizeof(struct process*));
 	while(j >=0)
 		job.freejobs[j--]  = 0;
 	job_unlock();
@@ -1119,8 +1207,7 @@ int job_post(pid_t pid, pid_t join)
 		if(val && (pw=job_byjid(val)) != job.pwlist)
 		{
 			job_unlink(pw);
-			pw->p_nxtjob = job.pwlist;
-			job.pwlist = pw;
+			job_link(pw);
 		}
 	}
 	if(pw=freelist)
@@ -1131,23 +1218,24 @@ int job_post(pid_t pid, pid_t join)
 	job.numpost++;
 	if(join && job.pwlist)
 	{
-		/* join existing current job */
-		pw->p_nxtjob = job.pwlist->p_nxtjob;
+		/* join existing current job; pw replaces its top process in the job list */
 		pw->p_nxtproc = job.pwlist;
 		pw->p_job = job.pwlist->p_job;
+		job.pwlist = job.pwlist->p_nxtjob;
 	}
 	else
 	{
 		/* create a new job */
 		while((pw->p_job = job_alloc()) < 0)
 			job_wait((pid_t)1);
-		pw->p_nxtjob = job.pwlist;
 		pw->p_nxtproc = 0;
 	}
 	pw->p_exitval = job.exitval;
-	job.pwlist = pw;
+	job_link(pw);
+	jobtab[pw->p_job] = pw;
 	pw->p_env = sh.curenv;
 	pw->p_pid = pid;
+	job_hashpid(pw);
 	if(!sh.outpipe || sh.cpid==pid)
 		pw->p_flag = P_EXITSAVE;
 	pw->p_exitmin = sh.xargexit;
@@ -1205,28 +1293,71 @@ int job_post(pid_t pid, pid_t join)
  */
 static struct process *job_bypid(pid_t pid)
 {
-	struct process  *pw, *px;
-	for(pw=job.pwlist; pw; pw=pw->p_nxtjob)
-		for(px=pw; px; px=px->p_nxtproc)
+	struct process	*pw;
+	if(!pidtab)
+		return NULL;
+	for(pw=pidtab[pid&pidmask]; pw; pw=pw->p_nxtpid)
+	{
+		if(pw->p_pid==pid)
+			return pw;
+	}
+	return NULL;
+}
+
+/*
+ * add posted process <pw> to the process ID hash table
+ */
+static void job_hashpid(struct process *pw)
+{
+	struct process	**pp;
+	if(job.numpost > pidmask)
+	{
+		/* grow the table to keep the chains short */
+		struct process	**oldtab = pidtab, *px, *pxnext;
+		unsigned int	i, oldsize = oldtab ? pidmask+1 : 0;
+		pidmask = oldsize ? 2*oldsize-1 : 63;
+		pidtab = sh_newof(0,struct process*,pidmask+1,0);
+		for(i=0; i < oldsize; i++)
 		{
-			if(px->p_pid==pid)
-				return px;
+			for(px=oldtab[i]; px; px=pxnext)
+			{
+				pxnext = px->p_nxtpid;
+				pp = &pidtab[px->p_pid&pidmask];
+				px->p_nxtpid = *pp;
+				*pp = px;
+			}
 		}
-	return NULL;
+		free(oldtab);
+	}
+	pp = &pidtab[pw->p_pid&pidmask];
+	pw->p_nxtpid = *pp;
+	*pp = pw;
 }
 
 /*
- * return a pointer to a job given the job ID
+ * remove process <pw> from the process ID hash table
  */
-static struct process *job_byjid(int jobid)
+static void job_unhashpid(struct process *pw)
 {
-	struct process *pw;
-	for(pw=job.pwlist;pw; pw = pw->p_nxtjob)
+	struct process	**pp;
+	for(pp= &pidtab[pw->p_pid&pidmask]; *pp; pp= &(*pp)->p_nxtpid)
 	{
-		if(pw->p_job==jobid)
+		if(*pp==pw)
+		{
+			*pp = pw->p_nxtpid;
 			break;
+		}
 	}
-	return pw;
+}
+
+/*
+ * return a pointer to a job given the job ID
+ */
+static struct process *job_byjid(int jobid)
+{
+	if(jobid<=0 || jobid>jobmax)
+		return NULL;
+	return jobtab[jobid];
 }
 
 /*
@@ -1448,6 +1579,87 @@ done:
 	return nochild;
 }
 
+#if _JOB_PIDFD
+/*
+ * Sleep until one of the <n> running processes in <pids> has terminated or a
+ * signal other than SIGCHLD arrives. Each process gets a pidfd for the duration
+ * of the wait, so exits of other children neither wake nor interrupt us.
+ * Returns 0 if pidfds are unavailable, in which case the caller must block in waitpid(2).
+ */
+static int job_pollpids(const pid_t *pids, int n)
+{
+	static struct pollfd	*pfd;
+	static int		npfd;
+	static char		nopidfd;
+	sigset_t		mask;
+	int			i, r = 1, oerrno = errno;
+	if(nopidfd || sh.waitevent)
+		return 0;
+	if(n > npfd)
+		pfd = sh_newof(pfd,struct pollfd,npfd=n,0);
+	for(i=0; i < n; i++)
+	{
+		if((pfd[i].fd = (int)syscall(SYS_pidfd_open,pids[i],0)) < 0)
+		{
+			if(errno==ENOSYS || errno==EPERM)
+				nopidfd = 1;
+			r = 0;
+			break;
+		}
+		pfd[i].events = POLLIN;
+	}
+	if(r)
+	{
+		sigprocmask(SIG_BLOCK,NULL,&mask);
+		sigaddset(&mask,SIGCHLD);
+		if(ppoll(pfd,n,NULL,&mask) < 0 && errno==EINTR && (sh.trapnote&SH_SIGALRM))
+			sh_timetraps();
+	}
+	while(--i >= 0)
+		close(pfd[i].fd);
+	errno = oerrno;
+	return r;
+}
+#endif /* _JOB_PIDFD */
+
+/*
+ * Wait until any of the <n> processes in <pids> has terminated and return its index,
+ * or -1 if there are no children left to wait for or, if <intr> is set, if a trap
+ * was triggered while waiting.
+ * The exit status is left for job_wait() to collect.
+ */
+int	job_waitany(const pid_t *pids, int n, int intr)
+{
+	struct process	*pw;
+	int		i, nochild = 0, waited = 0;
+	job_lock();
+	while(1)
+	{
+		for(i=0; i < n; i++)
+		{
+			if(!(pw = job_bypid(pids[i])) || (pw->p_flag&P_DONE))
+				break;
+		}
+		if(i < n)
+			break;
+		if(nochild || (intr && waited && sh.trapnote))
+		{
+			i = -1;
+			break;
+		}
+		job.waitsafe = 0;
+#if _JOB_PIDFD
+		if(!job.savesig && job_pollpids(pids,n))
+			nochild = job_reap(SIGCHLD);
+		else
+#endif /* _JOB_PIDFD */
+		nochild = job_reap(job.savesig);
+		waited = 1;
+	}
+	job_unlock();
+	return i;
+}
+
 /*
  * move job to foreground if bgflag == 'f'
  * move job to background if bgflag == 'b'
@@ -1479,8 +1691,7 @@ int job_switch(struct process *pw,int bgflag)
 	else
 	{
 		job_unlink(pw);
-		pw->p_nxtjob = job.pwlist;
-		job.pwlist = pw;
+		job_link(pw);
 		msg = "";
 	}
 	hist_list(sh.hist_ptr,outfile,pw->p_name,'&',";");
@@ -1566,8 +1777,10 @@ static struct process *job_unpost(struct process *pwtop,int notify)
 		return NULL;
 	/* all processes complete, unpost job */
 	job_unlink(pwtop);
+	jobtab[pwtop->p_job] = NULL;
 	for(pw=pwtop; pw; pw=pw->p_nxtproc)
 	{
+		job_unhashpid(pw);
 		/* save the exit status for the pipefail option */
 		if(pw && pw->p_exitval)
 		{
@@ -1603,23 +1816,33 @@ static struct process *job_unpost(struct process *pwtop,int notify)
 }
 
 /*
- * unlink a job form the job list
+ * put a job at the top of the job list
+ */
+static void job_link(struct process *pw)
+{
+	pw->p_prvjob = NULL;
+	if(pw->p_nxtjob = job.pwlist)
+		job.pwlist->p_prvjob = pw;
+	job.pwlist = pw;
+}
+
+/*
+ * unlink a job from the job list
  */
 static void job_unlink(struct process *pw)
 {
-	struct process *px;
 	if(pw==job.pwlist)
 	{
 		job.pwlist = pw->p_nxtjob;
 		job.curpgid = 0;
-		return;
 	}
-	for(px=job.pwlist;px;px=px->p_nxtjob)
-		if(px->p_nxtjob == pw)
-		{
-			px->p_nxtjob = pw->p_nxtjob;
-			return;
-		}
+	else if(pw->p_prvjob)
+		pw->p_prvjob->p_nxtjob = pw->p_nxtjob;
+	else
+		return;
+	if(pw->p_nxtjob)
+		pw->p_nxtjob->p_prvjob = pw->p_prvjob;
+	pw->p_prvjob = NULL;
 }
 
 /*
@@ -47,6 +47,12 @@
 #include	"path.h"
 #include	"national.h"
 #include	"streval.h"
+#if _sys_mman
+#   include	<sys/mman.h>
+#endif
+#ifdef MAP_PRIVATE
+#   define COMSUB_MAPMIN	(64*1024)	/* map command substitution output files at least this large */
+#endif
 
 #if _WINIX
     static int Skip;
@@ -96,8 +102,31 @@ typedef struct  _mac_
 #define M_NAMECOUNT	7	/* ${#var*}	*/
 #define M_TYPE		8	/* ${@var}	*/
 
+/* patterns that patliteral() reduces to a literal */
+#define LIT_EXACT	1	/* lit	*/
+#define LIT_TAIL	2	/* *lit	*/
+#define LIT_HEAD	3	/* lit*	*/
+
+/*
+ * Cache of $((...)) expansion sites, keyed by the address of the source text,
+ * so that expanding the same word again does not lex the expression again.
+ * The compiled code is cached by sh_strnum(), keyed by the expression text.
+ */
+#define ARSITES		64
+
+static struct arsite
+{
+	const char	*src;		/* source text starting at "((" */
+	size_t		len;		/* length of source text up to and including "))" */
+	char		*text;		/* copy of source text */
+	char		*expr;		/* lexed expression */
+	int		flags;		/* argflag of lexed expression */
+} arsite[ARSITES];
+
 static noreturn void	mac_error(void);
 static int	substring(const char*, size_t, const char*, int[], int);
+static int	patliteral(char*, int, int*);
+static int	litmatch(const char*, int, const char*, int, int, int, int, int[]);
 static void	copyto(Mac_t*, int, int);
 static void	comsubst(Mac_t*, Shnode_t*, int);
 static int	varsub(Mac_t*);
@@ -910,15 +939,14 @@ done:
 }
 
 /*
- * copy <str> to stack performing sub-expression substitutions
+ * return the replacement string <cp> with its quoting processed, for
+ * mac_substitute(); the result must be freed
  */
-static void mac_substitute(Mac_t *mp, char *cp,char *str,int subexp[],int subsize)
+static char *mac_repstr(Mac_t *mp, char *cp)
 {
-	int	c,n;
 	char	*first=fcseek(0);
-	char	*ptr;
 	Mac_t	savemac;
-	n = stktell(sh.stk);
+	int	n = stktell(sh.stk);
 	savemac = *mp;
 	mp->pattern = 3;
 	mp->split = 0;
@@ -926,11 +954,21 @@ static void mac_substitute(Mac_t *mp, char *cp,char *str,int subexp[],int subsiz
 	fcsopen(cp);
 	copyto(mp,0,0);
 	sfputc(sh.stk,0);
-	ptr = cp = sh_strdup(stkptr(sh.stk,n));
+	cp = sh_strdup(stkptr(sh.stk,n));
 	stkseek(sh.stk,n);
 	*mp = savemac;
 	fcsopen(first);
-	first = cp;
+	return cp;
+}
+
+/*
+ * copy <str> to stack performing sub-expression substitutions
+ * in the replacement string <cp> returned by mac_repstr()
+ */
+static void mac_substitute(Mac_t *mp, char *cp,char *str,int subexp[],int subsize)
+{
+	int	c,n;
+	char	*first = cp;
 	while(1)
 	{
 		while((c= *cp++) && c!=ESCAPE);
@@ -959,7 +997,6 @@ static void mac_substitute(Mac_t *mp, char *cp,char *str,int subexp[],int subsiz
 	}
 	if(n=cp-first-1)
 		mac_copy(mp,first,n);
-	free(ptr);
 }
 
 #if  SHOPT_FILESCAN
@@ -1165,6 +1202,8 @@ static int varsub(Mac_t *mp)
 	char		idbuff[3], *id = idbuff, *pattern=0, *repstr=0, *arrmax=0;
 	char		*idx = 0;
 	int		var=1,addsub=0,oldpat=mp->pattern,idnum=0,flag=0,d;
+	int		litkind=0,litlen=0;
+	char		*repexp=0;
 	Stk_t		*stkp = sh.stk;
 	mp->wasexpan = 1;
 retry1:
@@ -1884,6 +1923,8 @@ retry1:
 		pattern = sh_strdup(argp);
 		if((type=='/' || c=='/') && (repstr = mac_getstring(pattern)))
 			replen = strlen(repstr);
+		if(c=='/' || c=='#' || c=='%')
+			litkind = patliteral(pattern,c!='/',&litlen);
 		if(v || c=='/' && offset>=0)
 			stkseek(stkp,offset);
 	}
@@ -1913,7 +1954,9 @@ retry2:
 					vsize = tsize;
 					oldv = v;
 					nmatch_prev = nmatch;
-					if(c=='%')
+					if(litkind)
+						nmatch = litmatch(v, vsize, pattern, litlen, litkind, c, flag & STR_MAXIMAL, match);
+					else if(c=='%')
 						nmatch = substring(v, tsize,
 							*pattern ? pattern : "~(E)$",
 							match,
@@ -1937,7 +1980,15 @@ retry2:
 					if(vsize)
 						mac_copy(mp,v,vsize);
 					if(nmatch && replen>0 && (match[1] || !nmatch_prev))
-						mac_substitute(mp,repstr,v,match,nmatch);
+					{
+						/* expand the replacement once unless it has expansions, which may have side effects */
+						if(!repexp || strpbrk(repstr,"$`"))
+						{
+							free(repexp);
+							repexp = mac_repstr(mp,repstr);
+						}
+						mac_substitute(mp,repexp,v,match,nmatch);
+					}
 					if(nmatch==0)
 						v += vsize;
 					else
@@ -2146,8 +2197,11 @@ retry2:
 	}
 	else if(argp)
 	{
-		if(c=='/' && replen>0 && pattern && strmatch("",pattern))
-			mac_substitute(mp,repstr,v,0,0);
+		if(c=='/' && replen>0 && pattern && !litkind && strmatch("",pattern))
+		{
+			repexp = mac_repstr(mp,repstr);
+			mac_substitute(mp,repexp,v,0,0);
+		}
 		if(c=='?')
 		{
 			if(np)
@@ -2198,6 +2252,8 @@ retry2:
 	}
 	if(pattern)
 		free(pattern);
+	if(repexp)
+		free(repexp);
 	if(idx)
 		free(idx);
 	return 1;
@@ -2240,6 +2296,9 @@ static void comsubst(Mac_t *mp,Shnode_t* t, int type)
 	int			newlines,bufsize,nextnewlines;
 	Sfoff_t			foff;
 	Namval_t		*np;
+	char			*map = NULL;
+	int			mapped = 0;
+	int			tmpout = 0;
 	savemac.wasexpan = 1;
 	nv_setoptimize(NULL);
 	sh.st.staklist=0;
@@ -2248,7 +2307,31 @@ static void comsubst(Mac_t *mp,Shnode_t* t, int type)
 		sp = 0;
 		fcseek(-1);
 		if(!t)
+		{
+			const char *src = fcfile() ? NULL : fcseek(0);
+			struct arsite *ap = &arsite[((uintptr_t)src>>3)%ARSITES];
+			if(src && src[0]=='(' && src[1]=='(' && ap->src==src && strncmp(src,ap->text,ap->len)==0)
+			{
+				/* cache hit: skip the source text and evaluate the lexed expression */
+				fcseek(ap->len);
+				fcsave(&save);
+				str = stkcopy(stkp,ap->expr);
+				num = sh_arith((ap->flags&ARG_RAW) ? str : sh_mactrim(str,3));
+				goto out_offset;
+			}
 			t = sh_dolparen((Lex_t*)sh.lex_context);
+			if(src && t && t->tre.tretyp==TARITH && !fcfile() && src[0]=='(' && src[1]=='(')
+			{
+				size_t len = fcseek(0) - src, size = strlen(t->ar.arexpr->argval) + 1;
+				free(ap->text);
+				ap->src = src;
+				ap->len = len;
+				ap->text = sh_malloc(len + size);
+				memcpy(ap->text,src,len);
+				ap->expr = memcpy(ap->text+len,t->ar.arexpr->argval,size);
+				ap->flags = t->ar.arexpr->argflag;
+			}
+		}
 		if(t && t->tre.tretyp==TARITH)
 		{
 			fcsave(&save);
@@ -2340,6 +2423,7 @@ static void comsubst(Mac_t *mp,Shnode_t* t, int type)
 			if(type==2 && sh.subshell && !sh.subshare)
 				sh_subfork();	/* subshares within virtual subshells are broken, so fork first */
 			sp = sh_subshell(t,sh_isstate(SH_ERREXIT),type);
+			tmpout = 1;
 		}
 		fcrestore(&save);
 	}
@@ -2368,9 +2452,31 @@ static void comsubst(Mac_t *mp,Shnode_t* t, int type)
 		sfseek(sp,0,SEEK_SET);
 		stkseek(stkp,soff+foff+64);
 		stkseek(stkp,soff);
+#ifdef COMSUB_MAPMIN
+		/*
+		 * read large output from the shell's own temporary file in place instead of copying it through
+		 * the stream buffer; a $(<file) is not mapped, as another process truncating it would raise SIGBUS
+		 */
+		if(tmpout && foff >= COMSUB_MAPMIN && foff < INT_MAX && sffileno(sp) >= 0)
+		{
+			sfsync(sp);
+			if((map = mmap(NULL,(size_t)foff,PROT_READ|PROT_WRITE,MAP_PRIVATE,sffileno(sp),0)) == MAP_FAILED)
+				map = NULL;
+		}
+#endif /* COMSUB_MAPMIN */
 	}
-	while((str=(char*)sfreserve(sp,SFIO_UNBOUND,0)) && (c=bufsize=sfvalue(sp))>0)
+	while(1)
 	{
+		if(map)
+		{
+			/* the mapped file is processed as a single buffer */
+			if(mapped++)
+				break;
+			str = map;
+			c = bufsize = (int)foff;
+		}
+		else if(!(str=(char*)sfreserve(sp,SFIO_UNBOUND,0)) || (c=bufsize=sfvalue(sp))<=0)
+			break;
 #if SHOPT_CRNL
 		/* eliminate <cr> */
 		char *dp;
@@ -2446,6 +2552,10 @@ static void comsubst(Mac_t *mp,Shnode_t* t, int type)
 		mac_copy(mp,&lastc,1);
 		lastc = 0;
 	}
+#ifdef COMSUB_MAPMIN
+	if(map)
+		munmap(map,(size_t)foff);
+#endif /* COMSUB_MAPMIN */
 	sfclose(sp);
 	return;
 }
@@ -2732,6 +2842,140 @@ static int substring(const char *string,size_t len,const char *pat,int match[],
 	return n;
 }
 
+/*
+ * If PAT is a literal string, or if ANCHORED is set one with a '*'
+ * before or after it, remove its quoting in place, set *LENP to the
+ * length of the literal and return LIT_EXACT, LIT_TAIL (*lit) or
+ * LIT_HEAD (lit*); otherwise return 0. A byte match is only a character match if the locale is
+ * single-byte or UTF-8, so no other locale gets a literal.
+ */
+static int patliteral(char *pat, int anchored, int *lenp)
+{
+	char	*sp=pat, *dp, *end=0;
+	int	kind = LIT_EXACT;
+	if(mbwide() && !(ast.locale.set&AST_LC_utf8))
+		return 0;
+	if(*sp=='*' && anchored)
+	{
+		kind = LIT_TAIL;
+		sp++;
+	}
+	for(dp=sp; *dp; dp++)
+	{
+		if(*dp=='\\')
+		{
+			if(!*++dp)
+				return 0;
+		}
+		else if(*dp=='*' && anchored && kind==LIT_EXACT && dp>sp && dp[1]==0)
+		{
+			kind = LIT_HEAD;
+			end = dp;
+			break;
+		}
+		else if(strchr("*?[]()|&!@+{}~^%",*dp))
+			return 0;
+	}
+	if(!end)
+		end = dp;
+	if(end==sp)
+		return 0;
+	for(dp=pat; sp < end; )
+	{
+		if(*sp=='\\')
+			sp++;
+		*dp++ = *sp++;
+	}
+	*dp = 0;
+	*lenp = dp-pat;
+	return kind;
+}
+
+/*
+ * Find the first or last occurrence of the N-byte literal LIT in the
+ * SIZE bytes at V.
+ */
+static const char *litfind(const char *v, int size, const char *lit, int n, int last)
+{
+	const char *cp;
+	if(last)
+	{
+		for(cp=v+size-n; cp>=v; cp--)
+			if(*cp==*lit && memcmp(cp,lit,n)==0)
+				return cp;
+		return NULL;
+	}
+#if _lib_memmem
+	return memmem(v,size,lit,n);
+#else
+	for(cp=v; cp=memchr(cp,*lit,size-n+1-(cp-v)); cp++)
+		if(memcmp(cp,lit,n)==0)
+			return cp;
+	return NULL;
+#endif
+}
+
+/*
+ * Match a pattern that patliteral() reduced to the N-byte literal LIT
+ * of the given KIND against the SIZE bytes at V, for ${v/pat} (C=='/'),
+ * ${v#pat} (C=='#') or ${v%pat} (C=='%'), taking the longest match if
+ * MAXIMAL is set. Return and store the match as strngrpmatch() would.
+ */
+static int litmatch(const char *v, int size, const char *lit, int n, int kind, int c, int maximal, int match[])
+{
+	const char *cp;
+	if(n > size)
+		return 0;
+	switch(kind)
+	{
+	    case LIT_EXACT:
+		if(c=='#')
+			cp = memcmp(v,lit,n) ? NULL : v;
+		else if(c=='%')
+			cp = memcmp(v+size-n,lit,n) ? NULL : v+size-n;
+		else
+			cp = litfind(v,size,lit,n,0);
+		if(!cp)
+			return 0;
+		match[0] = cp-v;
+		match[1] = match[0]+n;
+		break;
+	    case LIT_HEAD:
+		if(c=='#')
+		{
+			if(memcmp(v,lit,n))
+				return 0;
+			match[0] = 0;
+			match[1] = maximal ? size : n;
+		}
+		else
+		{
+			if(!(cp = litfind(v,size,lit,n,!maximal)))
+				return 0;
+			match[0] = cp-v;
+			match[1] = size;
+		}
+		break;
+	    case LIT_TAIL:
+		if(c=='#')
+		{
+			if(!(cp = litfind(v,size,lit,n,maximal)))
+				return 0;
+			match[0] = 0;
+			match[1] = cp-v+n;
+		}
+		else
+		{
+			if(memcmp(v+size-n,lit,n))
+				return 0;
+			match[0] = maximal ? 0 : size-n;
+			match[1] = size;
+		}
+		break;
+	}
+	return 1;
+}
+
 #if SHOPT_MULTIBYTE
 	static char	*_lastchar(const char *string, const char *endstring)
 	{
@@ -147,8 +147,7 @@ noreturn void sh_main(int ac, char *av[], Shinit_f userinit)
 			/* preset aliases for interactive ksh/sh */
 			for(tp = shtab_aliases; *tp->sh_name; tp++)
 			{
-				Namval_t *np = sh_calloc(1,sizeof(Namval_t));
-				np->nvname = (char*)tp->sh_name;	/* alias name */
+				Namval_t *np = nv_newnode(tp->sh_name);	/* alias name */
 				np->nvflag = tp->sh_number;		/* attributes (must include NV_NOFREE) */
 				np->nvalue = (void*)tp->sh_value;	/* non-freeable value */
 				dtinstall(sh.alias_tree,np);
@@ -385,6 +384,7 @@ static void	exfile(Sfio_t *iop,int fno)
 				}
 				if(!(sh.fdstatus[fno]&IOCLEX))
 					sh_fcntl(fno,F_SETFD,FD_CLOEXEC);
+				sh_tcacheopen(fno,sh.st.filename);
 			}
 			iop = sh_iostream(fno);
 		}
@@ -458,8 +458,7 @@ static void	exfile(Sfio_t *iop,int fno)
 		if(sh_isstate(SH_INTERACTIVE) && jmpval==SH_JMPERREXIT && sh.heredocs)
 		{
 			Lex_t *lp;
-			sfclose(sh.heredocs);
-			sh.heredocs = NULL;
+			sh_ioheredocclose();
 			lp = (Lex_t*)sh.lex_context;
 			lp->heredoc = NULL;
 			sh_lexopen(lp,0);
@@ -590,6 +589,7 @@ static void	exfile(Sfio_t *iop,int fno)
 		job.waitall = job.curpgid = 0;
 		error_info.flags |= ERROR_INTERACTIVE;
 		t = (Shnode_t*)sh_parse(iop,0);
+		sh_tcacheadd(iop,t);
 		if(!sh_isstate(SH_INTERACTIVE) && !sh_isoption(SH_CFLAG))
 			error_info.flags &= ~ERROR_INTERACTIVE;
 		sh.readscript = 0;
@@ -621,6 +621,7 @@ static void	exfile(Sfio_t *iop,int fno)
 	}
 done:
 	sh_popcontext(&buff);
+	sh_tcacheclose(fno);
 	if(sh_isstate(SH_INTERACTIVE))
 	{
 		if(isatty(0) && !sh_isoption(SH_CFLAG))
@@ -44,6 +44,8 @@ static Dtdisc_t	_Refdisc =
 
 static void	pushnam(Namval_t*,void*);
 static char	*staknam(Namval_t*, char*);
+static void	env_put(Namval_t*);
+static void	env_unscope(Dt_t*);
 static void	rightjust(char*, int, int);
 static char	*lastdot(char*, int);
 
@@ -90,7 +92,6 @@ struct sh_type
 #endif
 
 char		nv_local = 0;
-static void(*nullscan)(Namval_t*,void*);
 
 /* ========	name value pair routines	======== */
 
@@ -816,7 +817,7 @@ Namval_t *nv_create(const char *name,  Dt_t *root, int flags, Namfun_t *dp)
 				if((rp=sh.st.real_fun) && !rp->sdict && (flags&NV_STATIC))
 				{
 					Dt_t *dp = dtview(sh.var_tree,NULL);
-					rp->sdict = dtopen(&_Nvdisc,Dtoset);
+					rp->sdict = dtopen(&_Nvdisc,Dtohash);
 					dtview(rp->sdict,dp);
 					dtview(sh.var_tree,rp->sdict);
 				}
@@ -894,7 +895,10 @@ Namval_t *nv_create(const char *name,  Dt_t *root, int flags, Namfun_t *dp)
 								np->nvname = nq->nvname;
 #if SHOPT_NAMESPACE
 								if(sh.namespace && nv_dict(sh.namespace)==sh.var_tree && nv_isattr(nq,NV_EXPORT))
+								{
 									nv_onattr(np,NV_EXPORT);
+									env_change();
+								}
 #endif /* SHOPT_NAMESPACE */
 								if(nq==OPTINDNOD)
 								{
@@ -1195,7 +1199,7 @@ Namval_t *nv_create(const char *name,  Dt_t *root, int flags, Namfun_t *dp)
 								ap = nv_arrayptr(np);
 							}
 							if(n && ap && !ap->table)
-								ap->table = dtopen(&_Nvdisc,Dtoset);
+								ap->table = dtopen(&_Nvdisc,Dtohash);
 							if(ap && ap->table && (nq=nv_search(sub,ap->table,n)))
 								nq->nvmeta = np;
 							if(nq && nv_isnull(nq))
@@ -1296,6 +1300,8 @@ void nv_delete(Namval_t* np, Dt_t *root, int flags)
 			xp->root = 0;
 	}
 #endif
+	if(np && (root==sh.fun_tree || root==sh.bltin_tree || (flags&NV_FUNCTION) || is_afunction(np) || is_abuiltin(np)))
+		sh_cmdchanged();
 	if(!np && !root && flags==0)
 	{
 		if(Refdict)
@@ -1335,7 +1341,7 @@ void nv_delete(Namval_t* np, Dt_t *root, int flags)
 					nv_associative(np,0,NV_AFREE);
 					free(np->nvfun);
 				}
-				free(np);
+				nv_freenode(np);
 			}
 		}
 	}
@@ -1379,6 +1385,8 @@ Namval_t *nv_open(const char *name, Dt_t *root, int flags)
 	sh.last_root = root;
 	if(root==sh.fun_tree)
 	{
+		/* a function may be (re)defined, e.g. over a dummy node left by 'unset -f' in a virtual subshell */
+		sh_cmdchanged();
 		flags |= NV_NOREF;
 		msg = e_badfun;
 		if(strchr(name,'.'))
@@ -1597,6 +1605,20 @@ static void ja_restore(void);
 static char *savep;
 static char savechars[8+1];
 
+/*
+ * The string value last grown by += is given room to spare, and its length
+ * and allocated size are remembered here, so that appending to it again
+ * neither has to find its end nor, most of the time, reallocate it.
+ * Anything else that stores to <vpp> forgets the value.
+ */
+static struct Appendval
+{
+	void		**vpp;		/* where the value is stored */
+	char		*cp;		/* the value */
+	size_t		len;		/* its string length */
+	size_t		size;		/* its allocated size */
+} appendval;
+
 /*
  * Put value <sp> into name-value node <np>.
  * If <np> is an array, then the element given by the
@@ -1611,6 +1633,7 @@ void nv_putval(Namval_t *np, const char *sp, int flags)
 	void		**vpp;	/* pointer to value pointer */
 	unsigned int	size = 0;
 	int		was_local = nv_local;
+	struct Appendval known = {0};	/* value being appended to, if remembered */
 #if SHOPT_FIXEDARRAY
 	Namarr_t	*ap;
 #endif /* SHOPT_FIXEDARRAY */
@@ -1657,6 +1680,8 @@ void nv_putval(Namval_t *np, const char *sp, int flags)
 	nv_local=0;
 	if(flags&(NV_NOREF|NV_NOFREE))
 	{
+		if(appendval.vpp==&np->nvalue)
+			appendval.vpp = NULL;
 		if(np->nvalue && np->nvalue!=sp && !nv_isattr(np,NV_NOFREE))
 			free(np->nvalue);
 		np->nvalue = (void*)sp;
@@ -1673,6 +1698,13 @@ void nv_putval(Namval_t *np, const char *sp, int flags)
 		vpp = &np->nvalue;
 	if(*vpp==Empty)
 		*vpp = NULL;
+	if(vpp==appendval.vpp)
+	{
+		/* take it over; only the append below puts it back */
+		appendval.vpp = NULL;
+		if(*vpp==appendval.cp && (flags&NV_APPEND))
+			known = appendval;
+	}
 	if(nv_isattr(np,NV_INTEGER))
 	{
 		if(nv_isattr(np, NV_DOUBLE) == NV_DOUBLE)
@@ -1692,7 +1724,7 @@ void nv_putval(Namval_t *np, const char *sp, int flags)
 				else
 					ld = sh_arith(sp);
 				if(!*vpp)
-					*vpp = new_of(Sfdouble_t,0);
+					*vpp = nv_arraynum(np,vpp,sizeof(Sfdouble_t));
 				else if(flags&NV_APPEND)
 					old = *(Sfdouble_t*)*vpp;
 				*(Sfdouble_t*)*vpp = old ? ld+old : ld;
@@ -1712,7 +1744,7 @@ void nv_putval(Namval_t *np, const char *sp, int flags)
 				else
 					d = sh_arith(sp);
 				if(!*vpp)
-					*vpp = new_of(double,0);
+					*vpp = nv_arraynum(np,vpp,sizeof(double));
 				else if(flags&NV_APPEND)
 					od = *(double*)*vpp;
 				*(double*)*vpp = od ? d+od : d;
@@ -1756,7 +1788,7 @@ void nv_putval(Namval_t *np, const char *sp, int flags)
 				else if(sp)
 					ll = (Sflong_t)sh_arith(sp);
 				if(!*vpp)
-					*vpp = new_of(Sflong_t,0);
+					*vpp = nv_arraynum(np,vpp,sizeof(Sflong_t));
 				else if(flags&NV_APPEND)
 					oll = *(Sflong_t*)*vpp;
 				*(Sflong_t*)*vpp = ll + oll;
@@ -1810,7 +1842,7 @@ void nv_putval(Namval_t *np, const char *sp, int flags)
 				{
 					int16_t os=0;
 					if(!*vpp)
-						*vpp = new_of(int16_t,0);
+						*vpp = nv_arraynum(np,vpp,sizeof(int16_t));
 					else if(flags&NV_APPEND)
 						os = *(int16_t*)*vpp;
 					*(int16_t*)*vpp = os + (int16_t)l;
@@ -1819,7 +1851,7 @@ void nv_putval(Namval_t *np, const char *sp, int flags)
 				{
 					int32_t ol=0;
 					if(!*vpp)
-						*vpp = new_of(int32_t,0);
+						*vpp = nv_arraynum(np,vpp,sizeof(int32_t));
 					else if(flags&NV_APPEND)
 						ol = *(int32_t*)*vpp;
 					*(int32_t*)*vpp = l + ol;
@@ -1952,7 +1984,7 @@ void nv_putval(Namval_t *np, const char *sp, int flags)
 				{
 					if(dot==0)
 						return;
-					append = strlen(*vpp);
+					append = known.cp ? known.len : strlen(*vpp);
 					if(!tofree || size)
 					{
 						offset = stktell(sh.stk);
@@ -1977,7 +2009,24 @@ void nv_putval(Namval_t *np, const char *sp, int flags)
 				}
 				else
 				{
-					if(tofree && tofree!=Empty && tofree!=AltEmpty)
+					if(append && tofree && tofree!=Empty && tofree!=AltEmpty)
+					{
+						/* grow geometrically so that repeated appends take amortized linear time */
+						if(known.cp && known.size > dot+append)
+							cp = (char*)tofree;
+						else
+						{
+							known.size = dot+append+1;
+							known.size += known.size/2;
+							cp = (char*)sh_realloc((void*)tofree, known.size);
+						}
+						tofree = 0;
+						appendval.vpp = vpp;
+						appendval.cp = cp;
+						appendval.len = dot+append;
+						appendval.size = known.size;
+					}
+					else if(tofree && tofree!=Empty && tofree!=AltEmpty)
 					{
 						cp = (char*)sh_realloc((void*)tofree, dot+append+1);
 						tofree = 0;
@@ -2016,7 +2065,7 @@ void nv_putval(Namval_t *np, const char *sp, int flags)
 			free((void*)tofree);
 	}
 	if(!was_local && ((flags&NV_EXPORT) || nv_isattr(np,NV_EXPORT)))
-		env_change();
+		env_put(np);
 	return;
 }
 
@@ -2134,7 +2183,54 @@ static char *staknam(Namval_t *np, char *value)
 }
 
 /*
- * Called from sh_envgen() to push an individual variable to export
+ * The environment list is kept between calls of sh_envgen() and is
+ * reused while the variable scope is the same and ast.env_serial shows
+ * no change to exported variables (see env_change()). Assigning to an
+ * exported variable only replaces its own entry. Entries for variables
+ * with disciplines or references are NULL and evaluated on each call.
+ */
+static struct Envcache
+{
+	Dt_t		*tree;		/* sh.var_tree the list was made for */
+	uint32_t	serial;		/* ast.env_serial when it was valid */
+	int		nenv;		/* number of entries */
+	int		maxenv;		/* allocated entries */
+	int		nvolatile;	/* number of NULL entries */
+	char		**env;		/* malloc'd "name=value" strings */
+	Namval_t	**nodes;	/* the node of each entry */
+} envcache;
+
+/*
+ * Return "name=value" for <np> in malloc'd space
+ */
+static char *envnam(Namval_t *np, const char *value)
+{
+	const char	*name = nv_name(np);
+	size_t		n = strlen(name), m = strlen(value);
+	char		*cp = sh_malloc(n+m+2);
+	memcpy(cp,name,n);
+	cp[n] = '=';
+	memcpy(cp+n+1,value,m+1);
+	return cp;
+}
+
+static void envadd(char *str, Namval_t *np)
+{
+	struct Envcache	*ep = &envcache;
+	if(ep->nenv >= ep->maxenv)
+	{
+		ep->maxenv = ep->maxenv ? 2*ep->maxenv : 64;
+		ep->env = sh_realloc(ep->env,ep->maxenv*sizeof(char*));
+		ep->nodes = sh_realloc(ep->nodes,ep->maxenv*sizeof(Namval_t*));
+	}
+	if(!str)
+		ep->nvolatile++;
+	ep->nodes[ep->nenv] = np;
+	ep->env[ep->nenv++] = str;
+}
+
+/*
+ * Called from env_build() to push an individual variable to export
  */
 static void pushnam(Namval_t *np, void *data)
 {
@@ -2143,38 +2239,108 @@ static void pushnam(Namval_t *np, void *data)
 	if(strchr(np->nvname,'.'))
 		return;
 	ap->tp = 0;
-	if(value=nv_getval(np))
-		*ap->argnam++ = staknam(np,value);
+	if(np->nvfun || nv_isref(np))
+		envadd(NULL,np);
+	else if(value=nv_getval(np))
+		envadd(envnam(np,value),np);
 }
 
 /*
- * Generate the environment list for the child.
+ * Rebuild the environment list from the exported variables in scope
  */
-char **sh_envgen(void)
+static void env_build(void)
 {
-	char **er;
-	int namec;
-	struct adata data;
-	int i;
+	struct Envcache	*ep = &envcache;
+	struct adata	data;
+	char		**old = ep->env, *cp;
+	Namval_t	**oldnodes = ep->nodes;
+	int		i, n = ep->nenv;
 	data.tp = 0;
 	data.mapname = 0;
-	/* L_ARGNOD gets generated automatically as full path name of command */
-	nv_offattr(L_ARGNOD,NV_EXPORT);
-	namec = nv_scan(sh.var_tree,nullscan,NULL,NV_EXPORT,NV_EXPORT);
-	namec += sh.save_env_n;
-	er = stkalloc(sh.stk,(namec+4)*sizeof(char*));
-	data.argnam = (er+=2) + sh.save_env_n;
+	ep->env = NULL;
+	ep->nodes = NULL;
+	ep->nenv = ep->maxenv = ep->nvolatile = 0;
 	/* Physically copy the saved non-importable env vars, as the old environ[] may be freed by exscript() */
-	for (i = 0; i < sh.save_env_n; i++)
+	for(i=0; i < sh.save_env_n; i++)
 	{
-		size_t sz = strlen(sh.save_env[i]) + 1;
-		char *cp = stkalloc(sh.stk, sz);
-		memcpy(cp, sh.save_env[i], sz);
-		er[i] = sh.save_env[i] = cp;
+		cp = sh_strdup(sh.save_env[i]);
+		envadd(sh.save_env[i] = cp,NULL);
 	}
 	/* Add exported vars */
-	nv_scan(sh.var_tree, pushnam,&data,NV_EXPORT, NV_EXPORT);
-	*data.argnam = 0;
+	nv_scan(sh.var_tree,pushnam,&data,NV_EXPORT,NV_EXPORT);
+	for(i=0; i < n; i++)
+		free(old[i]);
+	free(old);
+	free(oldnodes);
+	ep->tree = sh.var_tree;
+	ep->serial = ast.env_serial;
+}
+
+/*
+ * Record a change to exported variable <np>
+ * If the environment list is current, only the entry for <np> is replaced
+ */
+static void env_put(Namval_t *np)
+{
+	struct Envcache	*ep = &envcache;
+	char		*value;
+	int		i;
+	if(ep->tree==sh.var_tree && ep->serial==ast.env_serial && !np->nvfun && !nv_isref(np) && (value=nv_getval(np)))
+	{
+		for(i=sh.save_env_n; i < ep->nenv; i++)
+		{
+			if(ep->nodes[i]!=np)
+				continue;
+			free(ep->env[i]);
+			ep->env[i] = envnam(np,value);
+			ep->serial = env_change();
+			return;
+		}
+	}
+	env_change();
+}
+
+/*
+ * Forget the environment list if it was made for scope <root>
+ */
+static void env_unscope(Dt_t *root)
+{
+	if(envcache.tree==root)
+		envcache.tree = NULL;
+}
+
+/*
+ * Generate the environment list for the child.
+ */
+char **sh_envgen(void)
+{
+	struct Envcache	*ep = &envcache;
+	char		**er, *value;
+	int		i, n;
+	/* L_ARGNOD gets generated automatically as full path name of command */
+	if(nv_isattr(L_ARGNOD,NV_EXPORT))
+	{
+		nv_offattr(L_ARGNOD,NV_EXPORT);
+		env_change();
+	}
+	if(ep->tree!=sh.var_tree || ep->serial!=ast.env_serial)
+		env_build();
+	er = stkalloc(sh.stk,(ep->nenv+4)*sizeof(char*));
+	er += 2;
+	if(ep->nvolatile==0)
+	{
+		memcpy(er,ep->env,ep->nenv*sizeof(char*));
+		er[ep->nenv] = 0;
+		return er;
+	}
+	for(i=n=0; i < ep->nenv; i++)
+	{
+		if(er[n] = ep->env[i])
+			n++;
+		else if(value = nv_getval(ep->nodes[i]))
+			er[n++] = staknam(ep->nodes[i],value);
+	}
+	er[n] = 0;
 	return er;
 }
 
@@ -2263,6 +2429,14 @@ int nv_scan(Dt_t *root, void (*fn)(Namval_t*,void*), void *data,int mask, int fl
 	return sdata.scancount;
 }
 
+/*
+ * Scope dictionaries are emptied by sh_unscope() and kept here for reuse,
+ * so that a function call does not open and close a dictionary
+ */
+#define SCOPE_POOL	32
+static Dt_t	*scopepool[SCOPE_POOL];
+static int	nscopepool;
+
 /*
  * create a new environment scope
  */
@@ -2274,7 +2448,10 @@ void sh_scope(struct argnod *envlist, int fun)
 	if(sh.namespace)
 		newroot = nv_dict(sh.namespace);
 #endif /* SHOPT_NAMESPACE */
-	newscope = dtopen(&_Nvdisc,Dtoset);
+	if(nscopepool)
+		newscope = scopepool[--nscopepool];
+	else
+		newscope = dtopen(&_Nvdisc,Dtohash);
 	if(envlist)
 	{
 		dtview(newscope,(Dt_t*)sh.var_tree);
@@ -2454,6 +2631,8 @@ void	nv_unset(Namval_t *np,int flags)
 		vpp = &np->nvalue;
 	if(vpp && *vpp)
 	{
+		if(vpp==appendval.vpp)
+			appendval.vpp = NULL;
 		if(*vpp!=Empty && *vpp!=AltEmpty && !nv_isattr(np,NV_NOFREE))
 			free(*vpp);
 		*vpp = NULL;
@@ -2845,6 +3024,9 @@ void nv_newattr (Namval_t *np, unsigned newatts, int size)
 			/* Only EXPORT attribute has changed and thus all work has been done. */
 			return;
 	}
+	else if(n&NV_EXPORT)
+		/* other attributes can change the exported value */
+		env_change();
 	oldsize = nv_size(np);
 	if((size==oldsize|| (n&NV_INTEGER)) && !trans && ((n^newatts)&~NV_NOCHANGE)==0)
 	{
@@ -3189,7 +3371,7 @@ int nv_rename(Namval_t *np, int flags)
 		if(ap=nv_arrayptr(np))
 		{
 			if(!ap->table)
-				ap->table = dtopen(&_Nvdisc,Dtoset);
+				ap->table = dtopen(&_Nvdisc,Dtohash);
 			if(ap->table)
 				mp = nv_search(nv_getsub(np),ap->table,NV_ADD);
 			nv_arraychild(np,mp,0);
@@ -3437,7 +3619,11 @@ void sh_unscope(void)
 			sh.st.real_fun->sdict->view = dp;
 		}
 		sh.var_tree=dp;
-		dtclose(root);
+		env_unscope(root);
+		if(nscopepool < SCOPE_POOL && !dtfirst(root))
+			scopepool[nscopepool++] = root;
+		else
+			dtclose(root);
 	}
 }
 
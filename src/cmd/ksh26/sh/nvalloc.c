@@ -0,0 +1,172 @@
+/***********************************************************************
+*                                                                      *
+*               This software is part of the ast package               *
+*          Copyright (c) 2020-2026 Contributors to ksh 93u+m           *
+*                      and is licensed under the                       *
+*                 Eclipse Public License, Version 2.0                  *
+*                                                                      *
+*                A copy of the License is available at                 *
+*      https://www.eclipse.org/org/documents/epl-2.0/EPL-2.0.html      *
+*         (with md5 checksum 84283fa8859daf213bdda5a9f8d1be1d)         *
+*                                                                      *
+***********************************************************************/
+/*
+ * Slab allocator for name-value nodes
+ *
+ * Every variable, array element, compound member, function and alias that
+ * is added to a dictionary gets a Namval_t with its name stored right after
+ * it. Instead of a malloc(3) call per node, nodes are carved out of slabs,
+ * each holding nodes of a single size class (the name length rounded up to
+ * a pointer size). Each node is preceded by a pointer to its slab, so it can
+ * be freed without knowing its name length (nvname may be repointed).
+ * Freed nodes go on their slab's free list; a slab that becomes entirely
+ * free is released unless it is the last one of its class with room left.
+ * Nodes with names too long for any class are allocated individually.
+ *
+ * nv_newnode() and nv_freenode() are the only ways to get and release a
+ * node that nv_delete() may free; the live node count and the slab memory
+ * in use are reported in ${.sh.stats.nv_nodes} and ${.sh.stats.nv_bytes}.
+ */
+
+#include	"shopt.h"
+#include	"defs.h"
+
+#define SLAB_SIZE	(16*1024)		/* bytes per slab */
+#define SLAB_GRAIN	sizeof(void*)		/* size class granularity */
+#define SLAB_CLASSES	10			/* names up to 71 bytes on 64-bit systems */
+
+typedef struct Slab
+{
+	struct Slab	*next;		/* slabs of the same class with free slots */
+	struct Slab	*prev;
+	char		*free;		/* list of freed slots */
+	char		*bump;		/* next never-used slot */
+	char		*end;		/* end of the slots */
+	unsigned int	nused;		/* number of slots in use */
+	unsigned int	size;		/* slot size */
+	unsigned char	cls;		/* size class */
+	unsigned char	listed;		/* on the list for its class */
+} Slab_t;
+
+/* header in front of each node; NULL for an individually allocated node */
+typedef union Slot
+{
+	Slab_t		*slab;
+	void		*align;
+} Slot_t;
+
+static Slab_t	*slabs[SLAB_CLASSES];	/* slabs with free slots, by class */
+static int	nodes;			/* number of nodes in use */
+static int	bytes;			/* bytes of memory held for nodes */
+
+static void slab_link(Slab_t *sp)
+{
+	Slab_t	**head = &slabs[sp->cls];
+	sp->prev = NULL;
+	if(sp->next = *head)
+		(*head)->prev = sp;
+	*head = sp;
+	sp->listed = 1;
+}
+
+static void slab_unlink(Slab_t *sp)
+{
+	if(sp->prev)
+		sp->prev->next = sp->next;
+	else
+		slabs[sp->cls] = sp->next;
+	if(sp->next)
+		sp->next->prev = sp->prev;
+	sp->listed = 0;
+}
+
+/*
+ * return a zeroed node named <name>
+ */
+Namval_t *nv_newnode(const char *name)
+{
+	size_t		n = strlen(name)+1;
+	unsigned int	cls = (n+SLAB_GRAIN-1)/SLAB_GRAIN;
+	Slot_t		*slot;
+	Slab_t		*sp;
+	Namval_t	*np;
+	if(cls < SLAB_CLASSES)
+	{
+		if(!(sp = slabs[cls]))
+		{
+			sp = sh_malloc(SLAB_SIZE);
+			sp->free = NULL;
+			sp->bump = (char*)(sp+1);
+			sp->end = (char*)sp+SLAB_SIZE;
+			sp->nused = 0;
+			sp->size = sizeof(Slot_t)+sizeof(Namval_t)+cls*SLAB_GRAIN;
+			sp->cls = cls;
+			sp->next = NULL;
+			slab_link(sp);
+			bytes += SLAB_SIZE;
+		}
+		if(slot = (Slot_t*)sp->free)
+			sp->free = *(char**)(slot+1);
+		else
+		{
+			slot = (Slot_t*)sp->bump;
+			sp->bump += sp->size;
+		}
+		sp->nused++;
+		if(!sp->free && sp->bump+sp->size > sp->end)
+			slab_unlink(sp);
+	}
+	else
+	{
+		slot = sh_malloc(sizeof(Slot_t)+sizeof(Namval_t)+n);
+		sp = NULL;
+		bytes += sizeof(Slot_t)+sizeof(Namval_t)+n;
+	}
+	slot->slab = sp;
+	np = (Namval_t*)(slot+1);
+	memset(np,0,sizeof(Namval_t));
+	np->nvname = (char*)(np+1);
+	memcpy(np->nvname,name,n);
+	nodes++;
+	return np;
+}
+
+/*
+ * release a node obtained from nv_newnode()
+ */
+void nv_freenode(Namval_t *np)
+{
+	Slot_t	*slot = (Slot_t*)np-1;
+	Slab_t	*sp = slot->slab;
+	nodes--;
+	if(!sp)
+	{
+		bytes -= sizeof(Slot_t)+sizeof(Namval_t)+strlen((char*)(np+1))+1;
+		free(slot);
+		return;
+	}
+	*(char**)np = sp->free;
+	sp->free = (char*)slot;
+	if(--sp->nused==0 && (!sp->listed || slabs[sp->cls]!=sp || sp->next))
+	{
+		/* keep at most one empty slab per class */
+		if(sp->listed)
+			slab_unlink(sp);
+		free(sp);
+		bytes -= SLAB_SIZE;
+		return;
+	}
+	if(!sp->listed)
+		slab_link(sp);
+}
+
+#if SHOPT_STATS
+/*
+ * point the .sh.stats nodes for node accounting at the counters
+ */
+void nv_nodestats(Namval_t *nodes_np, Namval_t *bytes_np)
+{
+	nodes_np->nvalue = &nodes;
+	bytes_np->nvalue = &bytes;
+}
+#endif /* SHOPT_STATS */
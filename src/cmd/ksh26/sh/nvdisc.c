@@ -662,7 +662,8 @@ static void putdisc(Namval_t* np, const char* val, int flag, Namfun_t* fp)
 					if(mp->nvfun && !nv_isattr(mp,NV_NOFREE))
 						free(mp->nvfun);
 					dtdelete(sh.bltin_tree,mp);
-					free(mp);
+					nv_freenode(mp);
+					sh_cmdchanged();
 				}
 			}
 		}
@@ -728,6 +729,8 @@ Namfun_t *nv_disc(Namval_t *np, Namfun_t* fp, int mode)
 		return NULL;
 	if(mode==NV_CLONE && !fp)
 		return NULL;
+	if(nv_isattr(np,NV_EXPORT))
+		env_change();
 	if(fp)
 	{
 		fp->subshell = sh.subshell;
@@ -819,15 +822,6 @@ Namfun_t *nv_hasdisc(Namval_t *np, const Namdisc_t *dp)
 	return NULL;
 }
 
-static void *newnode(const char *name)
-{
-	int s;
-	Namval_t *np = sh_newof(0,Namval_t,1,s=strlen(name)+1);
-	np->nvname = (char*)np+sizeof(Namval_t);
-	memcpy(np->nvname,name,s);
-	return np;
-}
-
 /*
  * clone a numeric value
  */
@@ -1013,6 +1007,8 @@ Namval_t *nv_search(const char *name, Dt_t *root, int mode)
 		np = mode&NV_NOSCOPE ? NULL : dtmatch(sh.bltin_tree,name);
 	if(!np && (mode&NV_ADD))
 	{
+		if(root==sh.fun_tree || root==sh.bltin_tree)
+			sh_cmdchanged();
 		if(sh.namespace && !(mode&NV_NOSCOPE) && root==sh.var_tree)
 			root = nv_dict(sh.namespace);
 		else if(!dp && !(mode&NV_NOSCOPE))
@@ -1021,7 +1017,7 @@ Namval_t *nv_search(const char *name, Dt_t *root, int mode)
 			while(next=dtvnext(root))
 				root = next;
 		}
-		np = (Namval_t*)dtinsert(root,newnode(name));
+		np = (Namval_t*)dtinsert(root,nv_newnode(name));
 	}
 	if(dp)
 		dtview(root,dp);
@@ -1127,6 +1123,7 @@ Namval_t *sh_addbuiltin(const char *path, Shbltin_f bltin, void *extra)
 	char		*cp;
 	Namval_t	*np, *nq=0;
 	int		offset=stktell(sh.stk);
+	sh_cmdchanged();
 	if(extra==(void*)1)
 		name = path;
 	else if((name = path_basename(path))==path && bltin!=b_typeset && (nq=nv_bfsearch(name,sh.bltin_tree,NULL,&cp)))
@@ -1240,7 +1237,7 @@ static Namfun_t *clone_table(Namval_t* np, Namval_t *mp, int flags, Namfun_t *fp
 {
 	struct table	*tp = (struct table*)fp;
 	struct table	*ntp = (struct table*)nv_clone_disc(fp,0);
-	Dt_t		*oroot=tp->dict,*nroot=dtopen(&_Nvdisc,Dtoset);
+	Dt_t		*oroot=tp->dict,*nroot=dtopen(&_Nvdisc,Dtohash);
 	if(!nroot)
 		return NULL;
 	memcpy(ntp,fp,sizeof(struct table));
@@ -1248,7 +1245,7 @@ static Namfun_t *clone_table(Namval_t* np, Namval_t *mp, int flags, Namfun_t *fp
 	ntp->parent = nv_lastdict();
 	for(np=(Namval_t*)dtfirst(oroot);np;np=(Namval_t*)dtnext(oroot,np))
 	{
-		mp = (Namval_t*)dtinsert(nroot,newnode(np->nvname));
+		mp = (Namval_t*)dtinsert(nroot,nv_newnode(np->nvname));
 		nv_clone(np,mp,flags);
 	}
 	return &ntp->fun;
@@ -1295,7 +1292,7 @@ static void put_table(Namval_t* np, const char* val, int flags, Namfun_t* fp)
 		nv_unset(mp,flags);
 		nq = (Namval_t*)dtnext(root,mp);
 		dtdelete(root,mp);
-		free(mp);
+		nv_freenode(mp);
 	}
 	if(sh.last_root==root)
 		sh.last_root = NULL;
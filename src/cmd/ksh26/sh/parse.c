@@ -240,7 +240,7 @@ static void check_typedef(struct comnod *tp, char intypeset)
 		Dt_t *tp = sh.bltin_tree;
 		if(!dcl_tree)
 		{
-			dcl_tree = dtopen(&_Nvdisc, Dtoset);
+			dcl_tree = dtopen(&_Nvdisc,Dtohash);
 			dtview(sh.bltin_tree, dcl_tree);
 		}
 		sh.bltin_tree = dcl_tree;
@@ -1240,6 +1240,7 @@ static Shnode_t	*item(Lex_t *lexp,int flag)
 			lexp->lastline = saveline;
 			sh_syntax(lexp,0);
 		}
+		sh_casecomp(&t->sw);
 		break;
 	    }
 
@@ -33,6 +33,7 @@
 #include	"jobs.h"
 #include	"history.h"
 #include	"test.h"
+#include	"shnodes.h"
 #if SHOPT_DYNAMIC
 #include	<dlldefs.h>
 #endif
@@ -244,6 +245,7 @@ char *path_pwd(void)
 		}
 	}
 	nv_onattr(pwdnod,NV_EXPORT);
+	env_change();
 	/* Neither obtained the pwd nor can fall back to sane-ish $PWD: fall back to "." */
 	if(!cp)
 		cp = nv_getval(pwdnod);
@@ -566,12 +568,13 @@ static void funload(int fno, const char *name)
 			rp->fdict = funtree;
 		}
 		while((rp=dtnext(sh.fpathdict,rp)) && strcmp(pname,rp->fname)==0);
+		sh_cmdchanged();
 		sh_close(fno);
 		free(pname);
 		return;
 	}
 	if(!loopdetect_tree)
-		loopdetect_tree = dtopen(&_Nvdisc,Dtoset);
+		loopdetect_tree = dtopen(&_Nvdisc,Dtohash);
 	else if(nv_search(pname,loopdetect_tree,0))
 	{
 		errormsg(SH_DICT,ERROR_exit(ERROR_NOEXEC),"autoload loop: %s in %s",name,pname);
@@ -584,6 +587,7 @@ static void funload(int fno, const char *name)
 	sh.funload = 1;
 	sh.inlineno = 1;
 	error_info.line = 0;
+	sh_tcacheopen(fno,pname);
 	sh_eval(sfnew(NULL,buff,IOBSIZE,fno,SFIO_READ),SH_FUNEVAL);
 	sh_close(fno);
 	sh.readscript = 0;
@@ -1344,9 +1348,13 @@ static noreturn void exscript(char *path,char *argv[])
 	{
 		static Stk_t	*envstk;
 		Stk_t		*savstk = sh.stk;
+		char		**envp;
 		/* if one script executes another, sh_envgen may need to read from the old envstk, so both need to exist */
 		sh.stk = stkopen(STK_SMALL);
 		environ = sh_envgen();
+		/* the strings are shared with the environment list that sh_envgen() keeps */
+		for(envp = environ; *envp; envp++)
+			*envp = stkcopy(sh.stk,*envp);
 		if (envstk)
 			stkclose(envstk);
 		stkfreeze(envstk = sh.stk, 0);
@@ -40,14 +40,22 @@
 #   define PIPE_BUF	512
 #endif
 
+/*
+ * A saved variable. The copy of the variable's node starts at 'dict',
+ * so the dictionary and node pointers overlay its dictionary linkage.
+ */
 struct Link
 {
 	struct Link	*next;
 	Namval_t	*child;
+	struct Link	*hnext;	/* next in same svtab hash bucket */
 	Dt_t		*dict;
 	Namval_t	*node;
 };
 
+#define LINKSIZE	(offsetof(struct Link,dict)+sizeof(Namval_t))
+#define SVTAB_MIN	8	/* number of saved variables at which svtab is built */
+
 /*
  * The following structure is used for command substitution and (...)
  */
@@ -56,6 +64,9 @@ static struct subshell
 	struct subshell	*prev;	/* previous subshell data */
 	struct subshell	*pipe;	/* subshell where output goes to pipe on fork */
 	struct Link	*svar;	/* save shell variable table */
+	struct Link	**svtab;/* hash of svar by node pointer, once it has SVTAB_MIN entries */
+	unsigned int	svmask;	/* number of svtab buckets minus 1 */
+	unsigned int	nsvar;	/* number of entries in svar */
 	Dt_t		*sfun;	/* function scope for subshell */
 	Dt_t		*strack;/* tracked alias scope for subshell */
 	Pathcomp_t	*pathlist; /* for PATH variable */
@@ -188,29 +199,68 @@ void sh_subfork(void)
 	}
 }
 
+#define svhash(sp,np)	((unsigned int)(((uintptr_t)(np)>>4)^((uintptr_t)(np)>>12))&(sp)->svmask)
+
+/*
+ * (re)build the hash of saved variables of subshell <sp> with twice as many buckets as entries
+ */
+static void svtab_grow(struct subshell *sp)
+{
+	struct Link	*lp;
+	unsigned int	n = 2*SVTAB_MIN;
+	while(n < 2*sp->nsvar)
+		n <<= 1;
+	free(sp->svtab);
+	sp->svtab = sh_newof(0,struct Link*,n,0);
+	sp->svmask = n-1;
+	for(lp=sp->svar; lp; lp=lp->next)
+	{
+		lp->hnext = sp->svtab[svhash(sp,lp->node)];
+		sp->svtab[svhash(sp,lp->node)] = lp;
+	}
+}
+
+/*
+ * return the saved copy of <np> in subshell <sp>, or NULL if it hasn't been saved there
+ */
+static struct Link *svar_find(struct subshell *sp, Namval_t *np)
+{
+	struct Link	*lp;
+	if(sp->svtab)
+	{
+		for(lp=sp->svtab[svhash(sp,np)]; lp; lp=lp->hnext)
+			if(lp->node==np)
+				return lp;
+		return NULL;
+	}
+	for(lp=sp->svar; lp; lp=lp->next)
+		if(lp->node==np)
+			return lp;
+	return NULL;
+}
+
 int nv_subsaved(Namval_t *np, int flags)
 {
 	struct subshell	*sp;
-	struct Link		*lp, *lpprev;
+	struct Link		*lp, **lpp;
 	for(sp = (struct subshell*)subshell_data; sp; sp=sp->prev)
 	{
-		lpprev = 0;
-		for(lp=sp->svar; lp; lpprev=lp, lp=lp->next)
+		if(!(lp = svar_find(sp,np)))
+			continue;
+		if(flags&NV_TABLE)
 		{
-			if(lp->node==np)
+			for(lpp= &sp->svar; *lpp!=lp; lpp= &(*lpp)->next);
+			*lpp = lp->next;
+			if(sp->svtab)
 			{
-				if(flags&NV_TABLE)
-				{
-					if(lpprev)
-						lpprev->next = lp->next;
-					else
-						sp->svar = lp->next;
-					free(np);
-					free(lp);
-				}
-				return 1;
+				for(lpp= &sp->svtab[svhash(sp,np)]; *lpp!=lp; lpp= &(*lpp)->hnext);
+				*lpp = lp->hnext;
 			}
+			sp->nsvar--;
+			nv_freenode(np);
+			free(lp);
 		}
+		return 1;
 	}
 	return 0;
 }
@@ -263,14 +313,10 @@ void sh_assignok(Namval_t *np,int add)
 		if(!add || array_assoc(ap))
 			return;
 	}
-	for(lp=sp->svar; lp;lp = lp->next)
-	{
-		if(lp->node==np)
-			return;
-	}
-	/* first two pointers use linkage from np */
-	lp = (struct Link*)sh_malloc(sizeof(*np)+2*sizeof(void*));
-	memset(lp,0, sizeof(*mp)+2*sizeof(void*));
+	if(svar_find(sp,np))
+		return;
+	lp = (struct Link*)sh_malloc(LINKSIZE);
+	memset(lp,0,LINKSIZE);
 	lp->node = np;
 	if(!add &&  nv_isvtree(np))
 	{
@@ -294,8 +340,15 @@ void sh_assignok(Namval_t *np,int add)
 	}
 	lp->dict = dp;
 	mp = (Namval_t*)&lp->dict;
-	lp->next = subshell_data->svar;
-	subshell_data->svar = lp;
+	lp->next = sp->svar;
+	sp->svar = lp;
+	if(sp->svtab)
+	{
+		lp->hnext = sp->svtab[svhash(sp,np)];
+		sp->svtab[svhash(sp,np)] = lp;
+	}
+	if(++sp->nsvar >= SVTAB_MIN && sp->nsvar > sp->svmask)
+		svtab_grow(sp);
 	save = sh.subshell;
 	sh.subshell = 0;
 	mp->nvname = np->nvname;
@@ -318,6 +371,10 @@ static void nv_restore(struct subshell *sp)
 	Namval_t	*mpnext;
 	int		flags,nofree;
 	sh.nv_restore = 1;
+	/* entries are freed as we go, so lookups must use the list */
+	free(sp->svtab);
+	sp->svtab = NULL;
+	sp->svmask = 0;
 	for(lp=sp->svar; lp; lp=lq)
 	{
 		np = (Namval_t*)&lp->dict;
@@ -335,7 +392,7 @@ static void nv_restore(struct subshell *sp)
 		{
 			if(nv_isnull(mp) && !nv_isvtree(np))
 			{
-				free(mp);
+				nv_freenode(mp);
 				goto skip;
 			}
 			if(mp->nvalue && mp->nvalue!=Empty)
@@ -418,7 +475,7 @@ Dt_t *sh_subfuntree(int create)
 	{
 		if(sp && !sp->sfun)
 		{
-			sp->sfun = dtopen(&_Nvdisc,Dtoset);
+			sp->sfun = dtopen(&_Nvdisc,Dtohash);
 			dtview(sp->sfun,sh.fun_tree);
 			sh.fun_tree = sp->sfun;
 		}
@@ -832,6 +889,7 @@ Sfio_t *sh_subshell(Shnode_t *t, volatile int flags, int comsub)
 			Namval_t *np, *next_np;
 			/* Detach this scope from the unified view. */
 			sh.fun_tree = dtview(sp->sfun,0);
+			sh_cmdchanged();
 			/* Free all elements of the subshell function table. */
 			for(np = (Namval_t*)dtfirst(sp->sfun); np; np = next_np)
 			{
@@ -0,0 +1,247 @@
+/***********************************************************************
+*                                                                      *
+*               This software is part of the ast package               *
+*          Copyright (c) 2020-2026 Contributors to ksh 93u+m           *
+*                      and is licensed under the                       *
+*                 Eclipse Public License, Version 2.0                  *
+*                                                                      *
+*                A copy of the License is available at                 *
+*      https://www.eclipse.org/org/documents/epl-2.0/EPL-2.0.html      *
+*         (with md5 checksum 84283fa8859daf213bdda5a9f8d1be1d)         *
+*                                                                      *
+***********************************************************************/
+/*
+ * Transparent cache of compiled shell scripts
+ *
+ * If $SHCACHE names a private directory, the parse trees of scripts,
+ * dot scripts and autoload function files are written there in shcomp(1)
+ * format the first time they are read, and the next time the same file is
+ * read, the cached image is substituted for the script's file descriptor
+ * so that sh_parse() restores the trees instead of lexing and parsing.
+ *
+ * An image starts with a one-line key that identifies the source file by
+ * path, device, inode, size and modification time, the shell release and
+ * bytecode version, and a fingerprint of the parsing context (aliases and
+ * the options that change how the lexer and parser work). Any mismatch is
+ * a cache miss. A script that changes its own parsing context while it is
+ * being read (e.g. by defining aliases) is never stored, as replaying its
+ * trees could then give a different result than parsing it afresh.
+ */
+
+#include	"shopt.h"
+#include	"defs.h"
+#include	<tv.h>
+#include	"shnodes.h"
+#include	"path.h"
+#include	"io.h"
+#include	"version.h"
+
+#define CNTL(x)	((x)&037)
+
+#ifndef O_NOFOLLOW
+#   define O_NOFOLLOW	0
+#endif
+
+static const char header[6] = { CNTL('k'),CNTL('s'),CNTL('h'),0,SHCOMP_HDR_VERSION,0 };
+
+/* a tree image being captured while its source file is parsed */
+struct tcache
+{
+	struct tcache	*next;
+	int		fd;		/* file descriptor of the source script */
+	unsigned long	context;	/* parsing context fingerprint when opened */
+	Sfio_t		*image;		/* trees dumped so far */
+	char		*file;		/* cache file pathname */
+	char		key[1];		/* key line, newline-terminated */
+};
+
+static struct tcache	*pending;
+
+/*
+ * Return the cache directory, or NULL if caching is not enabled or not safe.
+ * The directory must be owned by the effective user and not writable by others.
+ */
+static char *cachedir(void)
+{
+	Namval_t	*np;
+	char		*dir;
+	struct stat	statb;
+	if(sh_isoption(SH_RESTRICTED) || sh_isoption(SH_PRIVILEGED) || sh.shcomp)
+		return NULL;
+	if(!(np = nv_search("SHCACHE",sh.var_tree,0)) || !(dir = nv_getval(np)) || *dir!='/')
+		return NULL;
+	if(stat(dir,&statb)<0 || !S_ISDIR(statb.st_mode) || statb.st_uid!=geteuid() || (statb.st_mode&(S_IWGRP|S_IWOTH)))
+		return NULL;
+	return dir;
+}
+
+/*
+ * Fingerprint of everything besides the script text that influences its parse tree
+ */
+static unsigned long context(void)
+{
+	Namval_t	*np;
+	char		*cp;
+	unsigned long	h = 0;
+	for(np = dtfirst(sh.alias_tree); np; np = dtnext(sh.alias_tree,np))
+	{
+		h = memsum(np->nvname,strlen(np->nvname)+1,h);
+		if(cp = nv_getval(np))
+			h = memsum(cp,strlen(cp)+1,h);
+	}
+	h = (h<<1) | (sh_isoption(SH_POSIX)!=0);
+	h = (h<<1) | (sh_isoption(SH_BRACEEXPAND)!=0);
+	h = (h<<1) | (sh_isoption(SH_KEYWORD)!=0);
+	h = (h<<1) | (sh_isoption(SH_VERBOSE)!=0);
+	h = (h<<1) | (sh_isstate(SH_NOALIAS)!=0);
+	return h;
+}
+
+static struct tcache *lookup(int fd)
+{
+	struct tcache *tp;
+	for(tp = pending; tp; tp = tp->next)
+		if(tp->fd==fd)
+			return tp;
+	return NULL;
+}
+
+static void drop(struct tcache *tp)
+{
+	struct tcache **tpp;
+	for(tpp = &pending; *tpp; tpp = &(*tpp)->next)
+	{
+		if(*tpp==tp)
+		{
+			*tpp = tp->next;
+			break;
+		}
+	}
+	if(tp->image)
+		sfclose(tp->image);
+	free(tp->file);
+	free(tp);
+}
+
+/*
+ * Write the captured image to a temporary file and atomically rename it into place
+ */
+static void store(struct tcache *tp)
+{
+	char	*tmp, *base = sfstrbase(tp->image);
+	size_t	size = sfstrtell(tp->image), n;
+	ssize_t	r;
+	int	fd;
+	if(sferror(tp->image))
+		return;
+	tmp = sh_malloc(strlen(tp->file)+24);
+	sfsprintf(tmp,strlen(tp->file)+24,"%s.%jd.tmp",tp->file,(Sflong_t)sh.current_pid);
+	if((fd = open(tmp,O_WRONLY|O_CREAT|O_EXCL|O_cloexec,S_IRUSR|S_IWUSR)) >= 0)
+	{
+		for(n = 0; n < size; n += r)
+		{
+			if((r = write(fd,base+n,size-n)) < 0)
+			{
+				if(errno!=EINTR)
+					break;
+				r = 0;
+			}
+		}
+		if(close(fd)<0 || n<size || rename(tmp,tp->file)<0)
+			unlink(tmp);
+	}
+	free(tmp);
+}
+
+/*
+ * Called when script file <path> has been opened on <fd> and is about to be parsed.
+ * If a valid cached image exists, it is duplicated onto <fd> (positioned at the shcomp
+ * header) so that the caller transparently reads the compiled trees instead. Otherwise,
+ * if caching is enabled, the trees parsed from <fd> are captured by sh_tcacheadd().
+ */
+void sh_tcacheopen(int fd, const char *path)
+{
+	struct tcache	*tp;
+	struct stat	statb;
+	char		*dir, *key, *buf;
+	size_t		len;
+	int		cfd, fdflags;
+	if(fd<0 || !path || *path!='/' || !(dir = cachedir()) || sh_isoption(SH_NOEXEC) || sh_isoption(SH_VERBOSE))
+		return;
+	if(fstat(fd,&statb)<0 || !S_ISREG(statb.st_mode) || lookup(fd))
+		return;
+	sfprintf(sh.strbuf,"ksh tree cache %s/%d %ju/%ju %jd %jd.%09ld %lx %s\n",
+		SH_RELEASE, SHCOMP_HDR_VERSION,
+		(Sfulong_t)statb.st_dev, (Sfulong_t)statb.st_ino, (Sflong_t)statb.st_size,
+		(Sflong_t)statb.st_mtime, (long)ST_MTIME_NSEC_GET(&statb),
+		context(), path);
+	key = sfstruse(sh.strbuf);
+	len = strlen(key);
+	tp = new_of(struct tcache,len);
+	memcpy(tp->key,key,len+1);
+	tp->fd = fd;
+	tp->context = context();
+	tp->image = NULL;
+	tp->next = pending;
+	pending = tp;
+	sfprintf(sh.strbuf,"%s/%016lx",dir,memsum(tp->key,len,0));
+	tp->file = sh_strdup(sfstruse(sh.strbuf));
+	if((cfd = open(tp->file,O_RDONLY|O_NOFOLLOW|O_cloexec)) < 0)
+		return;
+	buf = sh_malloc(len);
+	if(fstat(cfd,&statb)>=0 && S_ISREG(statb.st_mode) && statb.st_uid==geteuid()
+	&& read(cfd,buf,len)==(ssize_t)len && memcmp(buf,tp->key,len)==0
+	&& (fdflags = fcntl(fd,F_GETFD,0)) >= 0 && dup2(cfd,fd)==fd)
+	{
+		/* cache hit: <fd> now reads the image, positioned at the shcomp header */
+		fcntl(fd,F_SETFD,fdflags);
+		drop(tp);
+	}
+	free(buf);
+	close(cfd);
+}
+
+/*
+ * Called after parsing tree <t> from stream <iop>. Appends it to the image being
+ * captured for <iop>, if any. When the end of the input is reached, the image is
+ * stored provided the parsing context did not change while the script was read.
+ */
+void sh_tcacheadd(Sfio_t *iop, const Shnode_t *t)
+{
+	struct tcache	*tp;
+	if(!pending || !(tp = lookup(sffileno(iop))))
+		return;
+	if(t)
+	{
+		if(!tp->image)
+		{
+			if(!(tp->image = sfstropen()))
+			{
+				drop(tp);
+				return;
+			}
+			sfputr(tp->image,tp->key,-1);
+			sfwrite(tp->image,header,sizeof(header));
+		}
+		if(sh_tdump(tp->image,t) < 0)
+		{
+			drop(tp);
+			return;
+		}
+	}
+	if(sfreserve(iop,0,0))
+		return;
+	if(tp->image && !sferror(iop) && tp->context==context())
+		store(tp);
+	drop(tp);
+}
+
+/*
+ * Abandon any image being captured for <fd>
+ */
+void sh_tcacheclose(int fd)
+{
+	struct tcache *tp;
+	if(pending && (tp = lookup(fd)))
+		drop(tp);
+}
@@ -24,13 +24,20 @@
 #include	"defs.h"
 #include	"FEATURE/time"
 
+/*
+ * Pending timers are kept in a binary min-heap ordered by wakeup time,
+ * so adding a timer and finding the next one to expire take O(log n).
+ * Deleted timers stay in the heap with a null action until they reach
+ * the top, as deleting must be safe to do while SIGALRM is handled.
+ */
 typedef struct _timer
 {
 	Sfdouble_t	wakeup;
 	Sfdouble_t	incr;
-	struct _timer	*next;
+	struct _timer	*next;		/* next on free list */
 	void 		(*action)(void*);
 	void		*handle;
+	int		index;		/* position in heap */
 } Timer_t;
 
 #define IN_ADDTIMEOUT	1
@@ -38,18 +45,69 @@ typedef struct _timer
 #define DEFER_SIGALRM	4
 #define SIGALRM_CALL	8
 
-static Timer_t *tptop, *tpmin, *tpfree;
+static Timer_t **heap, *tpfree;
+static int nheap, maxheap;
 static char time_state;
 
+/*
+ * current time in seconds on a clock that is not affected by changes to the system time
+ */
 static Sfdouble_t getnow(void)
 {
 	Sfdouble_t now;
+#ifdef CLOCK_MONOTONIC
+	struct timespec tp;
+	clock_gettime(CLOCK_MONOTONIC,&tp);
+	now = tp.tv_sec + 1.e-9*tp.tv_nsec;
+#else
 	struct timeval tp;
 	timeofday(&tp);
 	now = tp.tv_sec + 1.e-6*tp.tv_usec;
+#endif
 	return now+.001;
 }
 
+/*
+ * move the timer at <i> up or down the heap to restore heap order
+ */
+static void heap_fix(int i)
+{
+	Timer_t	*tp = heap[i];
+	int	j;
+	while(i>0 && heap[j=(i-1)/2]->wakeup > tp->wakeup)
+	{
+		heap[i] = heap[j];
+		heap[i]->index = i;
+		i = j;
+	}
+	while((j=2*i+1) < nheap)
+	{
+		if(j+1 < nheap && heap[j+1]->wakeup < heap[j]->wakeup)
+			j++;
+		if(heap[j]->wakeup >= tp->wakeup)
+			break;
+		heap[i] = heap[j];
+		heap[i]->index = i;
+		i = j;
+	}
+	heap[i] = tp;
+	tp->index = i;
+}
+
+/*
+ * remove the timer at the top of the heap
+ */
+static Timer_t *heap_pop(void)
+{
+	Timer_t *tp = heap[0];
+	if(--nheap > 0)
+	{
+		heap[0] = heap[nheap];
+		heap_fix(0);
+	}
+	return tp;
+}
+
 /*
  * set an alarm for <t> seconds
  */
@@ -81,11 +139,9 @@ static Sfdouble_t setalarm(Sfdouble_t t)
 /* signal handler for alarm call */
 static void sigalrm(int sig)
 {
-	Timer_t *tp, *tplast, *tpold, *tpnext;
+	Timer_t *tp;
 	Sfdouble_t now;
-	static Sfdouble_t left;
 	NOT_USED(sig);
-	left = 0;
 	if(time_state&SIGALRM_CALL)
 		time_state &= ~SIGALRM_CALL;
 	else if(alarm(0))
@@ -102,65 +158,46 @@ static void sigalrm(int sig)
 	while(1)
 	{
 		now = getnow();
-		tpold = tpmin = 0;
-		for(tplast=0,tp=tptop; tp; tp=tpnext)
+		/* recycle deleted timers */
+		while(nheap && !heap[0]->action)
+		{
+			tp = heap_pop();
+			tp->next = tpfree;
+			tpfree = tp;
+		}
+		if(nheap && heap[0]->wakeup <= now)
 		{
-			tpnext = tp->next;
-			if(tp->action)
+			void	(*action)(void*);
+			void	*handle;
+			tp = heap[0];
+			action = tp->action;
+			handle = tp->handle;
+			if(tp->incr)
 			{
-				if(tp->wakeup <=now)
-				{
-					if(!tpold || tpold->wakeup>tp->wakeup)
-						tpold = tp;
-				}
-				else
-				{
-					if(!tpmin || tpmin->wakeup>tp->wakeup)
-						tpmin=tp;
-				}
-				tplast = tp;
+				while((tp->wakeup += tp->incr) <= now);
+				heap_fix(0);
 			}
 			else
 			{
-				if(tplast)
-					tplast->next = tp->next;
-				else
-					tptop = tp->next;
+				heap_pop();
+				tp->action = 0;
 				tp->next = tpfree;
 				tpfree = tp;
 			}
-		}
-		if((tp=tpold) && tp->incr)
-		{
-			while((tp->wakeup += tp->incr) <= now);
-			if(!tpmin || tpmin->wakeup>tp->wakeup)
-				tpmin=tp;
-		}
-		if(tpmin && (left==0 || (tp && tpmin->wakeup < (now+left))))
-		{
-			if(left==0)
-				signal(SIGALRM,sigalrm);
-			left = setalarm(tpmin->wakeup-now);
-			if(left && (now+left) < tpmin->wakeup)
-				setalarm(left);
-			else
-				left=tpmin->wakeup-now;
-		}
-		if(tp)
-		{
-			void	(*action)(void*);
-			action = tp->action;
-			if(!tp->incr)
-				tp->action = 0;
 			errno = EINTR;
 			time_state &= ~IN_SIGALRM;
-			(*action)(tp->handle);
+			(*action)(handle);
 			time_state |= IN_SIGALRM;
+			continue;
 		}
-		else
-			break;
+		break;
 	}
-	if(!tpmin)
+	if(nheap)
+	{
+		signal(SIGALRM,sigalrm);
+		setalarm(heap[0]->wakeup-now);
+	}
+	else
 		signal(SIGALRM,(sh.sigflag[SIGALRM]&SH_SIGFAULT)?sh_fault:SIG_DFL);
 	time_state &= ~IN_SIGALRM;
 	errno = EINTR;
@@ -190,11 +227,12 @@ void *sh_timeradd(Sfulong_t msec,int flags,void (*action)(void*),void *handle)
 	tp->action = action;
 	tp->handle = handle;
 	time_state |= IN_ADDTIMEOUT;
-	tp->next = tptop;
-	tptop = tp;
-	if(!tpmin || tp->wakeup < tpmin->wakeup)
+	if(nheap >= maxheap)
+		heap = sh_newof(heap,Timer_t*,maxheap=2*maxheap+16,0);
+	heap[tp->index=nheap++] = tp;
+	heap_fix(tp->index);
+	if(heap[0]==tp)
 	{
-		tpmin = tp;
 		fn = (Handler_t)signal(SIGALRM,sigalrm);
 		if((t= setalarm(t))>0 && fn  && fn!=(Handler_t)sigalrm)
 		{
@@ -202,16 +240,15 @@ void *sh_timeradd(Sfulong_t msec,int flags,void (*action)(void*),void *handle)
 			*hp = fn;
 			sh_timeradd((Sflong_t)(1000*t), 0, oldalrm, hp);
 		}
-		tp = tptop;
 	}
-	else if(tpmin && !tpmin->action)
+	else if(!heap[0]->action)
 		time_state |= DEFER_SIGALRM;
 	time_state &= ~IN_ADDTIMEOUT;
 	if(time_state&DEFER_SIGALRM)
 	{
 		time_state=SIGALRM_CALL;
 		sigalrm(SIGALRM);
-		if(tp!=tptop)
+		if(!tp->action)
 			tp=0;
 	}
 	return tp;
@@ -223,17 +260,15 @@ void *sh_timeradd(Sfulong_t msec,int flags,void (*action)(void*),void *handle)
 void	sh_timerdel(void *handle)
 {
 	Timer_t *tp = (Timer_t*)handle;
+	int i;
 	if(tp)
 		tp->action = 0;
 	else
 	{
-		for(tp=tptop; tp; tp=tp->next)
-			tp->action = 0;
-		if(tpmin)
-		{
-			tpmin = 0;
+		for(i=0; i < nheap; i++)
+			heap[i]->action = 0;
+		if(nheap)
 			setalarm((Sfdouble_t)0);
-		}
 		signal(SIGALRM,(sh.sigflag[SIGALRM]&SH_SIGFAULT)?sh_fault:SIG_DFL);
 	}
 }
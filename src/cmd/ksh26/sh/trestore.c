@@ -124,6 +124,7 @@ static Shnode_t *r_tree(void)
 			else
 				t->sw.swio = 0;
 			t->sw.swlst = r_switch();
+			sh_casecomp(&t->sw);
 			break;
 		case TFUN:
 		{
@@ -250,6 +251,8 @@ static void r_comarg(struct comnod *com)
 	com->comio = r_redirect();
 	com->comset = r_arg();
 	com->comstate = 0;
+	com->comcache = 0;
+	com->comgen = 0;
 	if(com->comtyp&COMSCAN)
 	{
 		com->comarg.ap = r_arg();
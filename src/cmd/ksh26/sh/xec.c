@@ -45,7 +45,7 @@
 #endif
 
 #if SHOPT_SPAWN
-    static pid_t sh_ntfork(const Shnode_t*,char*[],int*,int);
+    static pid_t sh_ntfork(const Shnode_t*,char*[],int*,int,int);
 #endif /* SHOPT_SPAWN */
 
 static void	sh_funct(Namval_t*, int, char*[], struct argnod*,int);
@@ -54,6 +54,9 @@ static void	coproc_init(int pipes[]);
 static void	*timeout;
 static char	nlock;
 static char	pipejob;
+#if SHOPT_SPAWN
+static const Shnode_t *bgspawn;	/* simple command of a background job that TCOM is to spawn (see check_bg_spawn) */
+#endif /* SHOPT_SPAWN */
 
 struct funenv
 {
@@ -538,6 +541,7 @@ int sh_eval(Sfio_t *iop, int mode)
 	volatile int traceon=0, lineno=0;
 	int binscript=sh.binscript;
 	char comsub = sh.comsub;
+	int fd = sffileno(iop);
 	io_save = iop; /* preserve correct value across longjmp */
 	sh.binscript = 0;
 	sh.comsub = 0;
@@ -560,6 +564,7 @@ int sh_eval(Sfio_t *iop, int mode)
 			errormsg(SH_DICT,ERROR_system(1),e_readscript);
 			UNREACHABLE();
 		}
+		sh_tcacheadd(iop,t);
 		if(!(mode&SH_FUNEVAL) || !sfreserve(iop,0,0))
 		{
 			if(!(mode&SH_READEVAL))
@@ -580,6 +585,7 @@ int sh_eval(Sfio_t *iop, int mode)
 			break;
 	}
 	sh_popcontext(buffp);
+	sh_tcacheclose(fd);
 	sh.binscript = binscript;
 	sh.comsub = comsub;
 	if(traceon)
@@ -782,6 +788,42 @@ static int check_exec_optimization(int type, int execflg, int execflg2, struct i
 	return 1;
 }
 
+#if SHOPT_SPAWN
+/*
+ * Check whether a background job '<t> &' may be run by spawning its command instead of forking the shell.
+ * This is the case for a simple command with literal arguments, no assignments and plain file redirections,
+ * when nothing observable (tracing, traps, job control) depends on the job being run by a shell process.
+ * Whether the command is external is only known after lookup, so TCOM may still decline (see bgspawn).
+ */
+static int check_bg_spawn(const Shnode_t *t)
+{
+	struct argnod	*argp;
+	struct ionod	*iop;
+	if((t->tre.tretyp&(FINT|FAMP|FPIN|FPOU|FCOOP))!=(FINT|FAMP)
+	|| t->fork.forkio
+	|| sh.subshell
+	|| job.jobcontrol
+	|| sh_isstate(SH_MONITOR)
+	|| sh_isoption(SH_BGNICE)
+	|| sh_isoption(SH_XTRACE)
+	|| sh.st.trap[SH_DEBUGTRAP])
+		return 0;
+	t = t->fork.forktre;
+	if(!t || (t->tre.tretyp&COMMSK)!=TCOM || t->com.comnamp || t->com.comset || !t->com.comarg.ap)
+		return 0;
+	if(t->tre.tretyp&COMSCAN)
+	{
+		for(argp=t->com.comarg.ap; argp; argp=argp->argnxt.ap)
+			if(!(argp->argflag&ARG_RAW))
+				return 0;
+	}
+	for(iop=t->com.comio; iop; iop=iop->ionxt)
+		if((iop->iofile&(IORAW|IODOC|IOVNM|IOLSEEK|IOPROCSUB|IOREWRITE))!=IORAW)
+			return 0;
+	return 1;
+}
+#endif /* SHOPT_SPAWN */
+
 /*
  * Main execution function: execute any type of command.
  */
@@ -863,7 +905,15 @@ int sh_exec(const Shnode_t *t, int flags)
 			char		*trap;
 			Namval_t	*np, *nq, *last_table;
 			struct ionod	*io;
-			int		command=0, flgs=NV_ASSIGN, jmpval=0;
+			int		command=0, flgs=NV_ASSIGN, jmpval=0, cached=0;
+#if SHOPT_SPAWN
+			int		bgtype = 0;
+			if(t==bgspawn)
+			{
+				bgtype = FAMP|FINT;
+				bgspawn = 0;
+			}
+#endif /* SHOPT_SPAWN */
 			sh.bltindata.invariant = type>>(COMBITS+2);
 			type &= (COMMSK|COMSCAN);
 			sh_stats(STAT_SCMDS);
@@ -891,7 +941,22 @@ int sh_exec(const Shnode_t *t, int flags)
 #endif /* SHOPT_NAMESPACE */
 			com0 = com[0];
 			sh_offstate(SH_XARG);
-			while(np==SYSCOMMAND || !np && com0 && nv_search(com0,sh.fun_tree,0)==SYSCOMMAND)
+			/*
+			 * Reuse the function or builtin found the last time this node was run (or the knowledge
+			 * that there is none), unless anything that could change the result has happened since.
+			 * This only applies to a command name that is a literal word without '/' or '.'.
+			 */
+			if(!np && com0 && !sh.namespace && !sh_isstate(SH_EXEC))
+			{
+				if(t->com.comgen==sh.cmdgen)
+				{
+					np = t->com.comcache;
+					cached = 1;
+				}
+				else if(!strpbrk(com0,"/.") && (!(t->tre.tretyp&COMSCAN) || (argp=t->com.comarg.ap) && (argp->argflag&ARG_RAW)))
+					cached = 2;
+			}
+			while(cached!=1 && (np==SYSCOMMAND || !np && com0 && nv_search(com0,sh.fun_tree,0)==SYSCOMMAND))
 			{
 				int n = b_command(0,com,&sh.bltindata);
 				if(n==0)
@@ -909,7 +974,7 @@ int sh_exec(const Shnode_t *t, int flags)
 				sh.xargexit = 0;
 			}
 			argn -= command;
-			if(np && is_abuiltin(np))
+			if(np && is_abuiltin(np) && cached!=1)
 			{
 				if(!command)
 				{
@@ -924,7 +989,7 @@ int sh_exec(const Shnode_t *t, int flags)
 			}
 			if(com0)
 			{
-				if((!np || !np->nvflag) && !sh_isstate(SH_EXEC) && !strchr(com0,'/'))
+				if((!np || !np->nvflag) && !sh_isstate(SH_EXEC) && !strchr(com0,'/') && cached!=1)
 				{
 					Dt_t *root = command?sh.bltin_tree:sh.fun_tree;
 					np = nv_bfsearch(com0, root, &nq, &cp);
@@ -933,6 +998,11 @@ int sh_exec(const Shnode_t *t, int flags)
 						np = sh_fsearch(com0,0);
 #endif /* SHOPT_NAMESPACE */
 				}
+				if(cached==2 && !command && (!np || is_afunction(np) || is_abuiltin(np)))
+				{
+					((Shnode_t*)t)->com.comcache = np;
+					((Shnode_t*)t)->com.comgen = sh.cmdgen;
+				}
 				comn = com[argn-1];
 			}
 			io = t->tre.treio;
@@ -1077,7 +1147,7 @@ int sh_exec(const Shnode_t *t, int flags)
 					sfsync(sh.outpool);
 				if(!np && !sh_isstate(SH_EXEC))
 				{
-					if(!sh_isoption(SH_RESTRICTED) || !strchr(com0,'/'))
+					if(cached!=1 && (!sh_isoption(SH_RESTRICTED) || !strchr(com0,'/')))
 					{
 						/* Search for a built-in again (including, unless restricted, a path-bound
 						 * builtin referenced by canonical path) in case no node pointer was found
@@ -1105,6 +1175,19 @@ int sh_exec(const Shnode_t *t, int flags)
 					else if(np = path_gettrackedalias(com0))
 						np = nv_search(nv_getval(np),sh.bltin_tree,0);
 				}
+#if SHOPT_SPAWN
+				if(bgtype)
+				{
+					/* only an external command can be spawned as a background job; let TFORK fork for anything else */
+					if(np || sh_isstate(SH_EXEC))
+					{
+						bgspawn = t;
+						skipexitset = 1;
+						break;
+					}
+					type |= bgtype;
+				}
+#endif /* SHOPT_SPAWN */
 				if(np && pipejob==2)
 				{
 					job_unlock();
@@ -1405,6 +1488,35 @@ int sh_exec(const Shnode_t *t, int flags)
 			int pipes[3];
 			if(sh.subshell)
 				sh_subtmpfile();
+#if SHOPT_SPAWN
+			if(!com && check_bg_spawn(t))
+			{
+				/*
+				 * Background simple command: have TCOM spawn it like a foreground command,
+				 * doing its redirections in the parent, instead of forking the shell.
+				 */
+				int	ioset = sh.st.ioset, fd = -1;
+				if(!ioset && (fd = sh_chkopen(e_devnull))==0)
+					sh_close(fd);	/* standard input is closed; leave it to the forked child */
+				else
+				{
+					if(fd>0)
+					{
+						/* default std input for & */
+						sh_iosave(0,sh.topfd,NULL);
+						sh_iorenumber(fd,0);
+					}
+					bgspawn = t->fork.forktre;
+					sh_exec(t->fork.forktre,flags&~sh_state(SH_NOFORK));
+					if(sh.topfd > topfd)
+						sh_iorestore(topfd,0);
+					sh.st.ioset = ioset;
+					if(!bgspawn)
+						break;
+					bgspawn = 0;	/* not an external command */
+				}
+			}
+#endif /* SHOPT_SPAWN */
 			if(no_fork = check_exec_optimization(type,execflg,execflg2,t->fork.forkio))
 				parent = 0;
 			else
@@ -1433,9 +1545,21 @@ int sh_exec(const Shnode_t *t, int flags)
 #if SHOPT_SPAWN
 				if(com)
 				{
-					parent = sh_ntfork(t,com,&jobid,topfd);
+					parent = sh_ntfork(t,com,&jobid,topfd,type&(FAMP|FINT));
 					if(parent<0)
-						break;
+					{
+						int exitval = sh.exitval;
+						if(!(type&FAMP))
+							break;
+						/* a background job that failed to start must still leave a job behind */
+						if(!(parent = sh_fork(type,&jobid)))
+						{
+							sh.exitval = exitval;
+							sh_done(0);
+						}
+						sh.exitval = 0;
+						exitset();
+					}
 				}
 				else
 #endif /* SHOPT_SPAWN */
@@ -1457,7 +1581,11 @@ int sh_exec(const Shnode_t *t, int flags)
 				if(type&FPCL)
 					sh_close(sh.inpipe[0]);
 				if(type&(FCOOP|FAMP))
+				{
 					sh.bckpid = parent;
+					if(com && sh.topfd > topfd)
+						sh_iorestore(topfd,0);	/* undo the redirections done by sh_ntfork() */
+				}
 				else if(!(type&(FAMP|FPOU)))
 				{
 					if(!sh_isstate(SH_MONITOR))
@@ -2184,6 +2312,8 @@ int sh_exec(const Shnode_t *t, int flags)
 		    case TSW:
 		    {
 			const int eflag = flags & sh_state(SH_ERREXIT);
+			const struct swtab *tp;
+			int arm = 0;
 			char *r = sh_macpat(t->sw.swarg, flags & ARG_OPTIMIZE);
 			error_info.line = t->sw.swline - sh.st.firstline;
 			if(sh.st.trap[SH_DEBUGTRAP])
@@ -2195,32 +2325,16 @@ int sh_exec(const Shnode_t *t, int flags)
 				av[3] = 0;
 				sh_debug(sh.st.trap[SH_DEBUGTRAP], NULL, NULL, av, 0);
 			}
-			t = (Shnode_t*)t->sw.swlst;
-			while(t)
+			tp = t->sw.swtab;
+			while(tp && arm < tp->narm && (arm = sh_casematch(tp,arm,r,flags))>=0)
 			{
-				struct argnod *rex = t->reg.regptr;
-				while(rex)
-				{
-					const unsigned char raw = rex->argflag & ARG_RAW;
-					char *s;
-					if(rex->argflag&ARG_MAC)
-						s = sh_macpat(rex,(flags & ARG_OPTIMIZE)|ARG_EXP);
-					else
-						s = rex->argval;
-					if(raw && strcmp(r,s)==0 || !raw && strmatch(r,s))
-					{
-						do				/* execute; keep going while ;& */
-							sh_exec(t->reg.regcom, t->reg.regflag ? eflag : flags);
-						while(t->reg.regflag==1 && (t = (Shnode_t*)t->reg.regnxt));
-						if(t && t->reg.regflag==0)	/* if not end or ;;& */
-							t = 0;			/* break outer loop */
-						break;
-					}
-					else
-						rex=rex->argnxt.ap;
-				}
-				if(t)
-					t=(Shnode_t*)t->reg.regnxt;
+				t = (Shnode_t*)tp->arm[arm];
+				do				/* execute; keep going while ;& */
+					sh_exec(t->reg.regcom, t->reg.regflag ? eflag : flags);
+				while(t->reg.regflag==1 && ++arm < tp->narm && (t = (Shnode_t*)tp->arm[arm]));
+				if(arm >= tp->narm || t->reg.regflag==0)	/* if end or not ;;& */
+					break;
+				arm++;
 			}
 			break;
 		    }
@@ -2311,7 +2425,7 @@ int sh_exec(const Shnode_t *t, int flags)
 					root = nv_dict(np);
 				else
 				{
-					root = dtopen(&_Nvdisc,Dtoset);
+					root = dtopen(&_Nvdisc,Dtohash);
 					nv_mount(np, NULL, root);
 					np->nvalue = Empty;
 					dtview(root,sh.var_base);
@@ -3322,7 +3436,7 @@ static void sigreset(int mode)
  * the sh_fork() codepath, even when the underlying system calls it uses wind up
  * being the same.
  */
-static pid_t sh_ntfork(const Shnode_t *t,char *argv[],int *jobid,int topfd)
+static pid_t sh_ntfork(const Shnode_t *t,char *argv[],int *jobid,int topfd,int flags)
 {
 	static pid_t	spawnpid;
 	struct checkpt	*buffp = stkalloc(sh.stk,sizeof(struct checkpt));
@@ -3397,7 +3511,17 @@ static pid_t sh_ntfork(const Shnode_t *t,char *argv[],int *jobid,int topfd)
 		for(pp=path_get(argv[0]); pp && !pp->lib ; pp=pp->next);
 		job_fork(-1);
 		jobfork = 1;
-		spawnpid = path_spawn(path,argv,arge,pp,(grp<<1)|1);
+		if(flags&FINT)
+		{
+			/* background job: the child ignores interrupts, as in the forked child in sh_exec() */
+			void (*intfun)(int) = signal(SIGINT,SIG_IGN);
+			void (*quitfun)(int) = signal(SIGQUIT,SIG_IGN);
+			spawnpid = path_spawn(path,argv,arge,pp,(grp<<1)|1);
+			signal(SIGINT,intfun);
+			signal(SIGQUIT,quitfun);
+		}
+		else
+			spawnpid = path_spawn(path,argv,arge,pp,(grp<<1)|1);
 	fail:
 		if(jobfork && spawnpid<0)
 			job_fork(-2);
@@ -3440,7 +3564,7 @@ static pid_t sh_ntfork(const Shnode_t *t,char *argv[],int *jobid,int topfd)
 		siglongjmp(*sh.jmplist,jmpval);
 	if(spawnpid>0)
 	{
-		_sh_fork(spawnpid,0,jobid);
+		_sh_fork(spawnpid,flags,jobid);
 		job_fork(spawnpid);
 		if(grp==1)
 			job.curpgid = spawnpid;
@@ -117,5 +117,31 @@ got=$(foo[23]=bar; export foo[23]+=baz 2>&1 && typeset -p foo)
 	"(expected status 0, $(printf %q "$exp");" \
 	"got status $e$( ((e>128)) && print -n /SIG && kill -l "$e"), $(printf %q "$got"))"
 
+# ======
+# Repeated += appends grow the value in place; anything else that changes
+# the value must not be mistaken for the value being appended to
+got=$(
+	a=x; a+=y; a+=z; b=$a; a=q; a+=r
+	print -r "$a $b"
+	a+=$a; a+=${a:1}
+	print -r "$a"
+	a=${a:0:2}; a+=s
+	print -r "$a"
+	unset a; a+=1; a+=2
+	(a+=3; a+=4; print -r "$a")
+	a+=5
+	print -r "$a"
+	read a <<< foo; a+=bar
+	print -r "$a"
+	typeset -A h; h[k]=a; h[k]+=b; h[k]+=c
+	print -r "${h[k]}"
+	buf=
+	for ((i=0; i<20000; i++)); do buf+=line$i$'\n'; done
+	print -r "${#buf}"
+)
+exp=$'qr xyz\nqrqrrqr\nqrs\n1234\n125\nfoobar\nabc\n188890'
+[[ $got == "$exp" ]] || err_exit 'repeated += appends give wrong value' \
+	"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
+
 # ======
 exit $((Errors<125?Errors:125))
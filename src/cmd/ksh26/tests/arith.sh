@@ -1142,5 +1142,29 @@ typeset -i y=0
 [[ $y == '-1' ]] || err_exit "variable declared with 'typeset -i' not consistently handled as signed int" \
 	"(expected '-1', got '$got')"
 
+# ======
+# Compiled arithmetic expressions are reused, but must still bind variables in the current scope
+function f1 { typeset n=$1; print -n $((n*10)) ${s:n:1}; }
+function f2 { typeset -i n=$1+1; f1 $n; print -n " $((n*10))"; }
+n=7 s=abcdefghij got=
+for i in 1 2 3
+do	got+="$(f1 $i) $(f2 $i) $((n*10)) ${s:n:1};"
+done
+exp='10 b 20 c 20 70 h;20 c 30 d 30 70 h;30 d 40 e 40 70 h;'
+[[ $got == "$exp" ]] || err_exit 'cached arithmetic uses wrong scope' \
+	"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
+x=0
+for ((i=0; i<100; i++))
+do	x=$((x+i))
+done
+((x==4950)) || err_exit "cached \$((x+i)) in loop (expected 4950, got $x)"
+unset v w
+w='v+1' v=4950 got=$((w*2)) v=1 got+=" $((w*2))"
+[[ $got == '9902 4' ]] || err_exit "cached arithmetic with recursive variable value (expected '9902 4', got '$got')"
+got=$(set +o posix; for i in 1 2; do print -n "$((010)) "; set -o posix; done)
+[[ $got == '10 8 ' ]] || err_exit "cached arithmetic ignores change of posix option (expected '10 8 ', got '$got')"
+got=$(for i in 1 2; do print -n "$(( i==2 ? 1/0 : 1 ))"; done 2>&1)
+[[ $got == 1*'divide by zero'* ]] || err_exit "error in cached arithmetic not reported (got $(printf %q "$got"))"
+
 # ======
 exit $((Errors<125?Errors:125))
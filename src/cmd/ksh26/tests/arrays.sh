@@ -951,5 +951,132 @@ exp='typeset -a toto=(SUCCESS)'
 [[ $got == "$exp" ]] || err_exit "array index containing expansion containing '=' misparsed in declaration command" \
 	"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
 
+# ======
+# Dictionaries are hash tables that are sorted only for listing; keep the order
+# exact across insertions, deletions and walks that add members
+typeset -A h
+for i in 5 3 9 1 7 2 8 4 6; do h[k$i]=$i; done
+got=${!h[*]}
+unset 'h[k3]' 'h[k8]'
+h[k0]=0 h[k35]=35
+got+=" / ${!h[*]}"
+for i in "${!h[@]}"; do unset "h[$i]"; h[$i.x]=x; done
+got+=" / ${!h[*]}"
+exp='k1 k2 k3 k4 k5 k6 k7 k8 k9 / k0 k1 k2 k35 k4 k5 k6 k7 k9 / k0.x k1.x k2.x k35.x k4.x k5.x k6.x k7.x k9.x'
+[[ $got == "$exp" ]] || err_exit 'associative array subscripts not listed in order' \
+	"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
+unset h
+got=$(zz_c=3 zz_a=1; function f { typeset zz_b=2 zz_d=4; set | grep '^zz_'; }; f)
+exp=$'zz_a=1\nzz_b=2\nzz_c=3\nzz_d=4'
+[[ $got == "$exp" ]] || err_exit 'variables of nested scopes not listed in order' \
+	"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
+
+# ======
+# Nodes come from a slab allocator that accounts for them in .sh.stats,
+# and unsetting a whole associative array frees its elements in one go
+if	[[ -v .sh.stats.nv_nodes ]]
+then	got=$("$SHELL" -c '
+		typeset -i i=0 n
+		typeset -A a
+		n=${.sh.stats.nv_nodes}
+		for ((i=0; i<1000; i++)); do a[key_$i]=$i; done
+		print $((.sh.stats.nv_nodes - n)) $((.sh.stats.nv_bytes > 0))
+		unset a
+		print $((.sh.stats.nv_nodes - n))
+	')
+	exp=$'1000 1\n0'
+	[[ $got == "$exp" ]] || err_exit 'node accounting in .sh.stats is off' \
+		"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
+fi
+got=$("$SHELL" -c '
+	typeset -A a=([x]=1 [y]=2 [z]=3)
+	typeset -n r=a[y]
+	unset a
+	print -r "${#a[@]} ${r-unset}"
+	a[q]=4
+	typeset -A c=([one]=(v=1) [two]=(v=2))
+	unset c
+	print -r "${#c[@]} ${c[one].v-unset}"
+')
+exp=$'0 unset\n0 unset'
+[[ $got == "$exp" ]] || err_exit 'unsetting a whole associative array fails' \
+	"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
+got=$(
+	typeset -A a
+	for ((i=100; i<200; i++)); do a[$i]=$i; done
+	for ((i=100; i<190; i++)); do unset "a[$i]"; done
+	for ((i=199; i>193; i--)); do unset "a[$i]"; done
+	a[000]=x a[999]=y
+	print -r -- "${!a[*]}"
+)
+exp='000 190 191 192 193 999'
+[[ $got == "$exp" ]] || err_exit 'associative array order lost when deleting from either end' \
+	"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
+
+# ======
+# Indexed arrays are grown in place
+got=$("$SHELL" -c '
+	typeset -a c=((v=0) (v=1))
+	for ((i=2; i<300; i++)); do c[i]=(v=$i); done
+	print -r "${#c[@]} ${c[0].v} ${c[31].v} ${c[32].v} ${c[299].v}"
+	a=(x)
+	for ((i=1; i<5000; i++)); do a+=("$i"); done
+	print -r "${#a[@]} ${a[0]} ${a[4999]}"
+	unset "a[4999]" "a[4998]"
+	a+=(y)
+	a[7000]=z
+	a+=(w)
+	set -- "${!a[@]}"
+	shift $(($# - 4))
+	print -r "${#a[@]} ${a[4998]} ${a[7001]} $*"
+	function f { typeset -a a; a+=(p q); print -r "${a[*]}"; }
+	f
+	(a+=(s); print -r "${a[7002]}")
+	print -r "${a[7002]-unset}"
+')
+exp=$'300 0 31 32 299\n5000 x 4999\n5001 y w 4997 4998 7000 7001\np q\ns\nunset'
+[[ $got == "$exp" ]] || err_exit 'appending to indexed arrays fails' \
+	"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
+
+# ======
+# Numeric indexed arrays keep their numbers packed
+got=$("$SHELL" -c '
+	typeset -a -i a=(1 2 3)
+	(a[1]=9; a[5]=4; unset a)
+	print -r "${a[*]}"
+	typeset -a -F b=(1.5 2)
+	(b[0]=3)
+	print -r "${b[*]}"
+	typeset -a -si s
+	for ((i=0; i<3000; i+=7)); do s[i]=i; done
+	((s[2996]+=4))
+	typeset -li s
+	s[3]=1234567890123
+	unset "s[7]"
+	print -r "${#s[@]} ${s[0]} ${s[2996]} ${s[3]} ${s[7]-unset}"
+	function f { typeset -a -i a; a[1]=7; print -r "${a[*]}"; }
+	f
+	typeset -A a
+	print -r "${a[*]}"
+')
+exp=$'1 2 3\n1.5000000000 2.0000000000\n429 0 3000 1234567890123 unset\n7\n1 2 3'
+[[ $got == "$exp" ]] || err_exit 'numeric indexed arrays fail' \
+	"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
+
+# ======
+# Reading a missing associative array subscript does not create the element
+got=$("$SHELL" -c '
+	typeset -A m=([a]=1 [b]=2)
+	for k in x y a z; do : "${m[$k]}"; done
+	print -r "${#m[@]} ${!m[*]} ${m[x]-unset}"
+	typeset -n r=m[q]
+	r=5
+	m[y]+=3
+	print -r "${#m[@]} ${m[q]} ${m[y]}"
+')
+exp=$'2 a b unset\n4 5 3'
+[[ $got == "$exp" ]] || err_exit 'reading missing associative subscripts fails' \
+	"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
+
 # ======
 exit $((Errors<125?Errors:125))
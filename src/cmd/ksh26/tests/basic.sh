@@ -1135,5 +1135,45 @@ then	# $0 should be the /dev/fd script name when the script is a process substit
 	fi
 fi
 
+# ======
+# Transparent cache of compiled scripts in $SHCACHE
+mkdir -m 700 "$tmp/shcache" && (
+	cd "$tmp/shcache" || exit
+	cat >lib.sh <<-\EOF
+	function cached_fn { print -r -- "fn ${1//o/0}"; }
+	cat <<-\END
+		heredoc body
+	END
+	EOF
+	cat >main.sh <<-\EOF
+	. ./lib.sh
+	case $1 in
+	one)	cached_fn foo ;;
+	*)	print other ;;
+	esac
+	EOF
+	exp=$'heredoc body\nfn f00'
+	got=$(SHCACHE=$PWD "$SHELL" main.sh one 2>&1)
+	[[ $got == "$exp" ]] || err_exit "SHCACHE: first run failed (expected $(printf %q "$exp"), got $(printf %q "$got"))"
+	set -- [0-9a-f]*
+	(($# == 2)) || err_exit "SHCACHE: expected 2 cache files, got $#: $*"
+	got=$(SHCACHE=$PWD "$SHELL" main.sh one 2>&1)
+	[[ $got == "$exp" ]] || err_exit "SHCACHE: cached run failed (expected $(printf %q "$exp"), got $(printf %q "$got"))"
+	print 'print changed' >>lib.sh
+	exp=$'heredoc body\nchanged\nfn f00'
+	got=$(SHCACHE=$PWD "$SHELL" main.sh one 2>&1)
+	[[ $got == "$exp" ]] || err_exit "SHCACHE: modified dot script not reparsed (expected $(printf %q "$exp"), got $(printf %q "$got"))"
+	rm -f [0-9a-f]*
+	print $'alias al=\'print aliased\'\nal' >alias.sh
+	got=$(SHCACHE=$PWD "$SHELL" alias.sh 2>&1)
+	[[ $got == aliased ]] || err_exit "SHCACHE: alias defined in script (got $(printf %q "$got"))"
+	set -- [0-9a-f]*
+	[[ -e $1 ]] && err_exit "SHCACHE: script that defines aliases should not be cached"
+	chmod g+w .
+	SHCACHE=$PWD "$SHELL" main.sh one >/dev/null 2>&1
+	set -- [0-9a-f]*
+	[[ -e $1 ]] && err_exit "SHCACHE: group-writable cache directory should be ignored"
+)
+
 # ======
 exit $((Errors<125?Errors:125))
@@ -1273,6 +1273,28 @@ then	got=$( { "$SHELL" -c '
 		"(got status $e$( ((e>128)) && print -n /SIG && kill -l "$e"), $(printf %q "$got"))"
 fi
 
+# ======
+# Timers added out of order must expire in order of their wakeup time, including
+# a repeating timer and timers deleted before they expire
+if	(builtin alarm) 2>/dev/null
+then	got=$("$SHELL" -c '
+		builtin alarm
+		typeset -i r=0
+		for t in 5 1 4 2 3 6
+		do	alarm t$t +$((t*.3))
+			eval "function t$t.alarm { print -n $t; }"
+		done
+		alarm -r rep +.4
+		function rep.alarm { print -n r; ((++r < 3)) || unset rep; }
+		unset t4 t6
+		sleep 1.7
+		print
+	' 2>&1)
+	exp='1r2r3r5'
+	[[ $got == "$exp" ]] || err_exit "timers expire in wrong order" \
+		"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
+fi
+
 # ======
 # Verify that the POSIX 'test' builtin exits with status 2 when given an invalid binary operator.
 for operator in '===' ']]'
@@ -1798,6 +1820,84 @@ got=$(unset IFS; printf "one\ntwo\nthree\n" | while read -r -d "" L; do printf "
 exp=$'end: <one\ntwo\nthree>'
 [[ $got == "$exp" ]] || err_exit "issue 926 r10 (expected $(printf %q "$exp"), got $(printf %q "$got"))"
 
+# ======
+# jobpool: bounded concurrency, per-item exit statuses, functions as workers
+function poolwork
+{
+	sleep $1
+	print -r "$1"
+	return $2
+}
+got=$(printf '%s\n' '.3 1' '.1 0' '.2 2' '.05 0' | jobpool -j2 -s st eval poolwork; print "rc=$? ${st[*]}")
+exp=$'.1\n.3\n.2\n.05\nrc=1 1 0 2 0'
+[[ $got == "$exp" ]] || err_exit "jobpool reading items from standard input" \
+	"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
+items=(one 'two words' three)
+got=$(jobpool -j1 -a items -s st print -r -- item; print "rc=$? ${#st[@]}")
+exp=$'item one\nitem two words\nitem three\nrc=0 3'
+[[ $got == "$exp" ]] || err_exit "jobpool with items from an array" \
+	"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
+got=$(print -n last | jobpool -j4 "$SHELL" -c 'read -r x; print -r "$x ${x:-eof} $0"'; print "rc=$?")
+exp=$' eof last\nrc=0'
+[[ $got == "$exp" ]] || err_exit "jobpool gives jobs /dev/null as standard input" \
+	"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
+unset items st
+got=$(jobpool -a items -s st false; print "rc=$? ${#st[@]}")
+[[ $got == 'rc=0 0' ]] || err_exit "jobpool with no items (got $(printf %q "$got"))"
+got=$(jobpool -j0 true 2>&1 </dev/null)
+[[ $? == 2 && $got == *'bad number'* ]] || err_exit "jobpool -j0 (got $(printf %q "$got"))"
+# the items read from standard input must not pile up on the shell's stack
+if	[[ -r /proc/$$/stat && $(uname) == Linux ]]
+then	function poolmem
+	{
+		print $(( $(cut -f 23 -d ' ' </proc/${.sh.pid}/stat) / 1024 ))
+	}
+	line=$(printf '%0100000d' 0)
+	for ((i=0; i<30; i++))
+	do	print -r -- "$line"
+	done >$tmp/jobpool_items
+	# 30 items of 100 KB would add about 3000 KiB
+	got=$(jobpool -j1 poolmem <$tmp/jobpool_items | sed -n '1p;$p')
+	(( ${got#*$'\n'} - ${got%$'\n'*} < 1024 )) || err_exit "jobpool memory grows with the number of items" \
+		"(first and last job have $(printf %q "$got") KiB)"
+	unset -f poolmem
+	unset line
+fi
+
+# ======
+# wait -n returns as soon as any one job terminates, with that job's exit status
+got=$(
+	sleep .4 & a=$!
+	{ sleep .1; exit 3; } & b=$!
+	sleep .2 & c=$!
+	for i in 1 2 3
+	do	wait -n -p p
+		print -n "$? $(( p==a ? 1 : p==b ? 2 : p==c ? 3 : 0 )),"
+	done
+	wait -n -p p
+	print -n "$? ${p-unset},"
+	{ exit 4; } & d=$!
+	sleep .1
+	wait -n "$d"
+	print -n "$?,"
+	sleep 2 & e=$!
+	{ sleep .1; exit 5; } & f=$!
+	wait -n "$e" %2
+	print "$?"
+	kill "$e"
+)
+exp='3 2,0 3,0 1,127 unset,4,5'
+[[ $got == "$exp" ]] || err_exit "wait -n (expected $(printf %q "$exp"), got $(printf %q "$got"))"
+got=$("$SHELL" -c '
+	trap "print -n trap," USR1
+	sleep 2 & e=$!
+	{ sleep .1; kill -s USR1 $$; } &
+	wait -n "$e"
+	print "$?"
+	kill "$e"
+')
+[[ $got == 'trap,1' ]] || err_exit "wait -n not interrupted by trap (got $(printf %q "$got"))"
+
 # ====== MUST BE AT END ======
 # checks for tests run in parallel (see top)
 wait "$parallel_1"
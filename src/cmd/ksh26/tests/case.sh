@@ -219,5 +219,28 @@ case ${.sh.version} in
 *)	warning ";;& operator supported as of 93u+m/1.1 but we're on ${.sh.version} -- skipping test"
 esac
 
+# ======
+# Patterns that are compiled into a dispatch table match like the ones that are not
+got=$("$SHELL" -c '
+	for w in a b c ab "a*" xabx "" zq; do
+		case $w in
+		a)	print -n 1 ;&
+		b)	print -n 2 ;;&
+		c|a)	print -n 3 ;;&
+		"$(print -n x >&2)"z*)	print -n 4 ;;
+		a*)	print -n 5 ;;&
+		*b)	print -n 6 ;;&
+		"a*")	print -n 7 ;;
+		*ab*)	print -n 8 ;;
+		"")	print -n 9 ;;
+		?q)	print -n 0 ;;
+		esac
+		print
+	done
+' 2>&1)
+exp=$'123x5\n2x6\n3x\nx568\nx57\nx8\nx9\nx4'
+[[ $got == "$exp" ]] || err_exit "case dispatch table gives wrong matches" \
+	"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
+
 # ======
 exit $((Errors<125?Errors:125))
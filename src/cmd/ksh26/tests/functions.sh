@@ -1582,5 +1582,38 @@ do	got=$(unset -f "$b"; PATH=/dev/null; "$b" --version 2>&1)
 		"(expected status $s and ERE match of $(printf %q "$exp"), got status $e and $(printf %q "$got"))"
 done
 
+# ======
+# The command found for a simple command is cached in its parse tree node;
+# defining and unsetting functions and changing PATH must invalidate that.
+mkdir "$tmp/cachepath" || err_exit "could not mkdir $tmp/cachepath"
+got=$(
+	unset -f cachetest
+	for i in 1 2 3 4 5 6 7
+	do	case $i in
+		2)	function cachetest { print -n F; } ;;
+		3)	(unset -f cachetest; cachetest 2>/dev/null || print -n U) ;;
+		4)	unset -f cachetest ;;
+		5)	printf '#!/bin/sh\nprintf X\n' >$tmp/cachepath/cachetest
+			chmod +x "$tmp/cachepath/cachetest"
+			PATH=$tmp/cachepath:$PATH ;;
+		6)	function cachetest { print -n G; } ;;
+		esac
+		cachetest 2>/dev/null || print -n N
+	done
+)
+exp=NFUFNXGG
+[[ $got == "$exp" ]] || err_exit "cached command lookup not invalidated (expected $exp, got $(printf %q "$got"))"
+
+
+# ======
+# Local scopes are reused between calls; none of their variables may survive
+function scope_set { typeset x=$1 y; y=$x; (($1 < 40)) && scope_set $(($1+1)); print -n "$y "; }
+function scope_get { print -n "${x-unset} ${y-unset};"; }
+got=$(scope_set 1; print; for i in 1 2; do scope_get; scope_set 39; done)
+exp="40 39 38 37 36 35 34 33 32 31 30 29 28 27 26 25 24 23 22 21 20 19 18 17 16 15 14 13 12 11 10 9 8 7 6 5 4 3 2 1 "
+exp+=$'\nunset unset;40 39 unset unset;40 39 '
+[[ $got == "$exp" ]] || err_exit 'local variables of reused function scopes' \
+	"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
+
 # ======
 exit $((Errors<125?Errors:125))
@@ -601,5 +601,38 @@ exp=$'startONE TWO THREEend\nstartONE/TWO/THREEend'
 	"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
 
 
+
+# ======
+# Small here-documents and here-strings bypass the temp file and constant
+# bodies are cached; make sure repeated, expanded and large ones still work
+got=
+for i in 1 2 3
+do	read -r a <<-\EOF
+		quoted $i
+	EOF
+	read -r b <<-EOF
+		expanded $i $(print sub$i)
+	EOF
+	read -r c <<< "string $i"
+	got+="$a|$b|$c;"
+done
+exp='quoted $i|expanded 1 sub1|string 1;quoted $i|expanded 2 sub2|string 2;quoted $i|expanded 3 sub3|string 3;'
+[[ $got == "$exp" ]] || err_exit 'here-documents in a loop' \
+	"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
+x=$(printf '%9000s' x)
+got=$(cat <<< "$x"; cat <<-EOF
+	$x
+	EOF
+)
+(( ${#got} == 18001 )) || err_exit "large here-documents and here-strings (expected 18001 bytes, got ${#got})"
+got=$({ head -n 1; cat; } <<-\EOF
+	one
+	two
+	EOF
+)
+exp=$'one\ntwo'
+[[ $got == "$exp" ]] || err_exit 'here-document not shared by commands reading one line at a time' \
+	"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
+
 # ======
 exit $((Errors<125?Errors:125))
@@ -1120,5 +1120,25 @@ got=$(eval ': >>&2' 2>&1)
 got=$(eval ': <<&2' 2>&1)
 [[ e=$? -eq 3 && $got == *'syntax error'* ]] || err_exit "<<&2 should be a syntax error (got \$?==$e, $(printf %q "$got"))"
 
+# ======
+# A background simple command with redirections is spawned without forking the shell,
+# with standard input from /dev/null and interrupts ignored, as a forked job would be.
+cat >$tmp/bgspawn.sh <<\EOF
+/bin/echo out >bgspawn.out 2>&1 </dev/null & wait $!
+print -r "st=$? forks=${.sh.stats.forks}"
+/bin/cat bgspawn.out
+/bin/cat & wait
+/bin/sh -c 'kill -s INT $$; echo survived' & wait
+/bin/cat 2>/dev/null <nonexistent & wait $!
+print -r "st=$?"
+foo() { return; }
+false; foo & wait $!
+print -r "st=$?"
+EOF
+got=$(cd "$tmp" && print input | "$SHELL" bgspawn.sh 2>&1)
+exp=$'st=0 forks=0\nout\nsurvived\nst=1\nst=1'
+[[ $got == "$exp" ]] || err_exit "background command with redirections" \
+	"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
+
 # ======
 exit $((Errors<125?Errors:125))
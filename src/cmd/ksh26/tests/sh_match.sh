@@ -1083,5 +1083,75 @@ got=${ $SHELL -c 'print ${!.sh.match} ${!.sh.match[1]} ${!.sh.match[2]}' }
 [[ $exp == "$got" ]] || err_exit "'print \${!.sh.match}' should not print excessive elements" \
 	"(expected ${ printf %q "$exp" }, got ${ printf %q "$got" })"
 
+# ======
+# More than eight patterns used in turn stay compiled in the pattern cache
+if	[[ -v .sh.stats.re_cachemiss ]]
+then	got=$("$SHELL" -c '
+		typeset -i i j n
+		for ((i=0; i<3; i++))
+		do	((i==1)) && n=${.sh.stats.re_cachemiss}
+			for ((j=0; j<20; j++))
+			do	[[ x$j == *$j[0-9] ]]
+			done
+		done
+		print $((.sh.stats.re_cachemiss - n)) $((.sh.stats.re_cachehit >= 40))
+	')
+	exp='0 1'
+	[[ $got == "$exp" ]] || err_exit 'patterns are evicted from the pattern cache too early' \
+		"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
+fi
+
+# ======
+# Patterns without backreferences are matched in time linear in the subject
+s=aaaaaaaaaaaaaaaaaaaaaaaaaaaaaa
+float t=SECONDS
+got=$("$SHELL" -c '
+	[[ $1 =~ ^(a+a+)+b$ ]] && print -n match || print -n nomatch
+	[[ $1 == @(a|aa)*b ]] && print " match" || print " nomatch"
+	[[ ${1}b =~ ^(a|aa)+(b)$ ]] && print ${.sh.match[2]}
+' _ "$s$s$s")
+exp=$'nomatch nomatch\nb'
+[[ $got == "$exp" ]] || err_exit 'matching a pattern with nested repetitions fails' \
+	"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
+(( (SECONDS - t) < 5 )) || err_exit "matching a pattern with nested repetitions takes exponential time ($((SECONDS - t)) seconds)"
+unset s t
+
+# ======
+# Subexpressions of nested repetitions and alternations are still found by
+# the POSIX rules when the automaton has found the match
+set --
+for t in \
+	'aaabb ad' '((a*)|(ab|a))+(.*)*((a|))*' '[aaabb ad][ab][ab][b ad][][]' \
+	'dabbb.ad.' '(.*)*((a*)*\<)*^a*' '[][][][]' \
+	'aaabb ad' '^?[ab](.*)((a*)*a*((b+){1,2}|..(a*)(a|))*(a|))' '[aaabb ad][aabb ad][][][]' \
+	'aaabb ad' '(.*)+[^a](.*)((\<(b+))c+|x?x?)*' '[aaabb ad][aaabb a][][]' \
+	'dabbb.ad.' '(.*)+[^a](.*)((\<(b+))c+|x?x?)*' '[dabbb.ad.][dabbb.ad][][]' \
+	'abcabc' '(a|ab)(c|bcd)(d*)' '[abc][ab][c][]' \
+	'xabcabcy' '((a|ab)(bc|c))+' '[abcabc][abc][ab][c]'
+do	set -- "$@" "$t"
+	(($# == 3)) || continue
+	if	[[ $1 =~ $2 ]]
+	then	got=$(printf '[%s]' "${.sh.match[@]}")
+	else	got=nomatch
+	fi
+	[[ $got == "$3" ]] || err_exit "wrong .sh.match for '$1' =~ '$2'" \
+		"(expected $(printf %q "$3"), got $(printf %q "$got"))"
+	set --
+done
+unset t
+
+# ======
+# Subjects without a literal that every match contains are rejected early;
+# literals that are optional or alternatives must not be required
+for pat in '*ERROR*' '~(i)*error*' '*@(ERROR|WARN)*' '*ER?(X)ROR*' '*{0,1}(LOG)ERROR*'
+do	[[ 'x ERROR y' == $pat ]] || err_exit "'x ERROR y' should match $pat"
+	[[ 'x ERRO y' == $pat ]] && err_exit "'x ERRO y' should not match $pat"
+done
+[[ 'a timeout=30 b' =~ timeout=([0-9]+) ]] && [[ ${.sh.match[1]} == 30 ]] || err_exit "'timeout=([0-9]+)' fails to match"
+[[ 'a timeout 30 b' =~ timeout=[0-9]+ ]] && err_exit "'timeout=[0-9]+' matches without '='"
+[[ 'a x' =~ (timeout=)?x ]] || err_exit "'(timeout=)?x' requires its optional literal"
+[[ 'xyz' =~ abc|xyz ]] || err_exit "'abc|xyz' requires one of its alternatives"
+[[ 'x ERRO y' == !(*ERROR*) ]] || err_exit "'!(*ERROR*)' requires its negated literal"
+
 # ======
 exit $((Errors<125?Errors:125))
@@ -157,5 +157,25 @@ chmod +x $tmp/foobar
 x=$($SHELL  -c "echo | $tmp/foobar")
 [[ $x == *Done* ]] || err_exit 'SIGCHLD blocked for script at end of pipeline'
 
+# ======
+# Many background jobs: each 'wait $pid' must find its own job and status,
+# also when waiting in reverse order after all have finished
+got=$("$SHELL" -c '
+	integer i n=300
+	typeset -a pid
+	for ((i=0; i<n; i++))
+	do	(exit $((i % 7))) &
+		pid[i]=$!
+	done
+	sleep .2
+	for ((i=n-1; i>=0; i--))
+	do	wait ${pid[i]}
+		st=$?
+		((st == i % 7)) || print -r "job $i: status $st"
+	done
+	print ok
+')
+[[ $got == ok ]] || err_exit "wrong exit statuses for many background jobs (got $(printf %q "$got"))"
+
 # ======
 exit $((Errors<125?Errors:125))
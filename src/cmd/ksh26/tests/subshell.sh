@@ -1249,5 +1249,55 @@ echo ok" 2>&1)
 [[ $exp == $got ]] || err_exit "PWD file descriptors made in virtual subshells leak out of subshells" \
 	"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
 
+# ======
+# Many variables changed, created and unset in nested virtual subshells are all restored
+typeset -i i
+for ((i=0; i<200; i++))
+do	typeset sv_$i=p$i
+done
+got=$(
+	for ((i=0; i<200; i+=2))
+	do	typeset sv_$i=c$i sv_new_$i=n$i
+	done
+	(
+		for ((i=0; i<200; i+=3))
+		do	unset sv_$i sv_new_$i
+		done
+		print -n "${sv_0-u}${sv_2-u}${sv_3-u}${sv_new_4-u},"
+	)
+	for ((i=0; i<200; i+=4))
+	do	unset sv_new_$i
+	done
+	print "$sv_0$sv_1$sv_3${sv_new_2-u}${sv_new_4-u}"
+)
+exp='uc2un4,c0p1p3n2u'
+[[ $got == "$exp" ]] || err_exit "variables in nested subshells (expected $(printf %q "$exp"), got $(printf %q "$got"))"
+got=
+for ((i=0; i<200; i++))
+do	eval "[[ \$sv_$i == p$i && -z \${sv_new_$i+set} ]]" || got+=" $i"
+done
+[[ -z $got ]] || err_exit "variables not restored after subshell:$got"
+unset i ${!sv_*}
+
+# ======
+# Large command substitution output that overflows into a temporary file is read back intact,
+# with trailing newlines stripped
+typeset -i i
+exp=
+for ((i=0; i<5000; i++))
+do	exp+="line $i of output"$'\n'
+done
+got=$(print -rn -- "$exp"; print -rn -- "$exp"; print; print)
+[ "$got" = "$exp${exp%$'\n'}" ] || err_exit "large command substitution output corrupted" \
+	"(expected length $((2*${#exp}-1)), got ${#got})"
+got=$(print -rn -- "${exp//$'\n'}"; printf '\n%.0s' {1..70000})
+[ "$got" = "${exp//$'\n'}" ] || err_exit "trailing newlines not stripped from large command substitution output" \
+	"(expected length $((${#exp}-5000)), got ${#got})"
+print -rn -- "$exp" >$tmp/large_comsub
+got=$(<$tmp/large_comsub)
+[ "$got" = "${exp%$'\n'}" ] || err_exit "large \$(<file) output corrupted" \
+	"(expected length $((${#exp}-1)), got ${#got})"
+unset i exp got
+
 # ======
 exit $((Errors<125?Errors:125))
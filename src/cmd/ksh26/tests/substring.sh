@@ -869,5 +869,17 @@ else
 	warning 'ksh too old for case modification expansions; skipping those tests'
 fi
 
+# ======
+# Literal patterns are matched without the regex engine; the results must not change
+got=$("$SHELL" -c '
+	v="a.b\\c*d.b\\c*e" x=5 i=0
+	print -r -- "${v//b\\c/X}|${v/\*/-}|${v//"*"/"$x"}|${v#*.}|${v##*.}|${v%.*}|${v%%.*}|${v%e}|${v%%b*}"
+	print -r -- "${v/#a./[\$x]}|${v/%e/Z}|${v//./}|${v/nope/Q}|${v##*"\\c"}|${v%"b\\c"*}"
+	print -r -- "${v//b/$((++i))}" $i
+' 2>&1)
+exp=$'a.X*d.X*e|a.b\\c-d.b\\c*e|a.b\\c5d.b\\c5e|b\\c*d.b\\c*e|b\\c*e|a.b\\c*d|a|a.b\\c*d.b\\c*|a.\n[$x]b\\c*d.b\\c*e|a.b\\c*d.b\\c*Z|ab\\c*db\\c*e|a.b\\c*d.b\\c*e|*e|a.b\\c*d.\na.1\\c*d.2\\c*e 2'
+[[ $got == "$exp" ]] || err_exit "literal pattern substitutions" \
+	"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
+
 # ======
 exit $((Errors<125?Errors:125))
@@ -1811,5 +1811,34 @@ do	got=$(eval "
 		"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
 done
 
+
+# ======
+# The environment list for external commands is kept between commands;
+# it must follow every change to exported variables
+got=$(
+	export A=1
+	B=2
+	env | grep '^[AB]='
+	A=3
+	env | grep '^[AB]='
+	export B
+	typeset -i16 A
+	env | grep '^[AB]='
+	function f { typeset -x C=4 A=local; env | grep '^[ABC]='; }
+	f
+	env | grep '^[ABC]='
+	(export B=sub; env | grep '^B=')
+	B=pre env | grep '^B='
+	function B.get { .sh.value=disc; }
+	env | grep '^B='
+	unset -f B.get
+	unset A
+	typeset +x B
+	env | grep '^[AB]=' || echo none
+)
+exp=$'A=1\nA=3\nA=16#3\nB=2\nA=local\nB=2\nC=4\nA=16#3\nB=2\nB=sub\nB=pre\nB=disc\nnone'
+[[ $got == "$exp" ]] || err_exit 'exported variables not passed on correctly' \
+	"(expected $(printf %q "$exp"), got $(printf %q "$got"))"
+
 # ======
 exit $((Errors<125?Errors:125))
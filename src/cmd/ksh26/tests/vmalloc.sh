@@ -0,0 +1,29 @@
+########################################################################
+#                                                                      #
+#              This file is part of the ksh 93u+m package              #
+#             Copyright (c) 2026 Contributors to ksh 93u+m             #
+#                      and is licensed under the                       #
+#                 Eclipse Public License, Version 2.0                  #
+#                                                                      #
+#                A copy of the License is available at                 #
+#      https://www.eclipse.org/org/documents/epl-2.0/EPL-2.0.html      #
+#         (with md5 checksum 84283fa8859daf213bdda5a9f8d1be1d)         #
+#                                                                      #
+########################################################################
+
+# Tests for the Vmalloc region allocator in libast, which the shell itself
+# does not use. The work is done by the vmtest program built from
+# src/lib/libast/tests/vmtest.c.
+
+. "${SHTESTS_COMMON:-${0%/*}/_common}"
+
+whence -q vmtest || { warning "vmtest command not found -- tests skipped"; exit 0; }
+
+# ======
+# Random allocation, freeing and resizing across all size classes, checked
+# against a copy of every block and vmstat(), with vmclear() between rounds
+got=$(vmtest 2>&1)
+(($? == 0)) && [[ -z $got ]] || err_exit 'vmalloc stress test failed' "(got $(printf %q "$got"))"
+
+# ======
+exit $((Errors<125?Errors:125))
@@ -0,0 +1,589 @@
+/***********************************************************************
+*                                                                      *
+*               This software is part of the ast package               *
+*          Copyright (c) 2020-2026 Contributors to ksh 93u+m           *
+*                      and is licensed under the                       *
+*                 Eclipse Public License, Version 2.0                  *
+*                                                                      *
+*                A copy of the License is available at                 *
+*      https://www.eclipse.org/org/documents/epl-2.0/EPL-2.0.html      *
+*         (with md5 checksum 84283fa8859daf213bdda5a9f8d1be1d)         *
+*                                                                      *
+***********************************************************************/
+#include	"dthdr.h"
+
+/*	Ordered set kept in an open-addressing hash table.
+**
+**	Searches, insertions and deletions probe a flat table of slots that
+**	hold the memoized hash value of each key next to its link, so a
+**	lookup touches no object but the one it finds and never restructures
+**	anything. The order needed by FIRST/LAST/NEXT/PREV/ATLEAST/ATMOST is
+**	kept in a separate array of links that is sorted only when one of
+**	those operations is done after the set has gained objects. Deleted
+**	objects leave holes in that array so that walking a set while
+**	deleting from it does not force a new sort.
+**
+**	The method type is DT_OSET, so dictionaries of this method can be
+**	viewpathed and walked in order exactly like Dtoset dictionaries.
+*/
+
+#define OH_MINZ		8	/* smallest table size			*/
+#define OH_FULL(h,n)	(((n) + (h)->ndel) * 4 > (h)->tblz * 3)
+
+#define OHKEY(dc,l)	_DTKEY((dc), _DTOBJ((dc), (l)))
+
+typedef struct _ohslot_s
+{	uint		hash;	/* memoized hash value of key		*/
+	Dtlink_t*	lnk;	/* object, NULL or OH_DELETED		*/
+} Ohslot_t;
+
+typedef struct _dtohash_s
+{	Dtdata_t	data;
+	Ohslot_t*	htbl;	/* open-addressing table		*/
+	ssize_t		tblz;	/* table size, a power of 2		*/
+	ssize_t		ndel;	/* deleted slots in table		*/
+	Dtlink_t**	list;	/* objects in order, NULL for holes	*/
+	ssize_t		lstz;	/* allocated size of list		*/
+	ssize_t		nlst;	/* used entries in list			*/
+	ssize_t		nhole;	/* deleted entries in list		*/
+	ssize_t		lead;	/* list holds only holes before this	*/
+	ssize_t		here;	/* fingered position in list		*/
+	int		sorted;	/* list holds all objects in order	*/
+} Dtohash_t;
+
+static Dtlink_t		_Ohdeleted;
+#define OH_DELETED	(&_Ohdeleted)
+
+/* find the slot holding key; *fs is set to the first slot usable for inserting it */
+static Ohslot_t* ohfind(Dt_t* dt, void* key, uint hsh, Ohslot_t** fs)
+{
+	Ohslot_t	*s;
+	ssize_t		i, mask;
+	Dtdisc_t	*disc = dt->disc;
+	Dtohash_t	*hash = (Dtohash_t*)dt->data;
+
+	*fs = NULL;
+	if(!hash->htbl)
+		return NULL;
+	mask = hash->tblz - 1;
+	for(i = hsh & mask;; i = (i + 1) & mask)
+	{	s = hash->htbl + i;
+		if(!s->lnk)
+		{	if(!*fs)
+				*fs = s;
+			return NULL;
+		}
+		else if(s->lnk == OH_DELETED)
+		{	if(!*fs)
+				*fs = s;
+		}
+		else if(s->hash == hsh && _DTCMP(dt, key, OHKEY(disc,s->lnk), disc) == 0)
+			return s;
+	}
+}
+
+/* make or resize the table so that it holds n objects at half load */
+static int ohtable(Dt_t* dt, ssize_t n)
+{
+	Ohslot_t	*htbl, *t, *endt;
+	ssize_t		k, i, mask;
+	Dtohash_t	*hash = (Dtohash_t*)dt->data;
+
+	for(k = OH_MINZ; k < 2*n; )
+		k *= 2;
+	if(!(htbl = (Ohslot_t*)(*dt->memoryf)(dt, 0, k*sizeof(Ohslot_t), dt->disc)) )
+	{	DTERROR(dt, "Error in allocating an open-addressing hash table");
+		return -1;
+	}
+	memset(htbl, 0, k*sizeof(Ohslot_t));
+
+	if(hash->htbl)
+	{	mask = k - 1;
+		for(endt = (t = hash->htbl) + hash->tblz; t < endt; ++t)
+		{	if(!t->lnk || t->lnk == OH_DELETED)
+				continue;
+			for(i = t->hash & mask; htbl[i].lnk; i = (i + 1) & mask)
+				;
+			htbl[i] = *t;
+		}
+		(void)(*dt->memoryf)(dt, hash->htbl, 0, dt->disc);
+	}
+	hash->htbl = htbl;
+	hash->tblz = k;
+	hash->ndel = 0;
+
+	return 0;
+}
+
+/* index of the first object in list whose key is not less than key */
+static ssize_t ohlower(Dt_t* dt, void* key)
+{
+	ssize_t		lo, hi, mid, m;
+	Dtdisc_t	*disc = dt->disc;
+	Dtohash_t	*hash = (Dtohash_t*)dt->data;
+	Dtlink_t	**list = hash->list;
+
+	lo = hash->lead;
+	hi = hash->nlst;
+	while(lo < hi)
+	{	mid = lo + (hi - lo) / 2;
+		for(m = mid; m < hi && !list[m]; ++m)
+			;
+		if(m == hi || _DTCMP(dt, key, OHKEY(disc,list[m]), disc) <= 0)
+			hi = mid;
+		else	lo = m + 1;
+	}
+	while(lo < hash->nlst && !list[lo])
+		++lo;
+	return lo;
+}
+
+/* bottom-up merge sort of n links in a[] using b[] as scratch space */
+static Dtlink_t** ohmerge(Dt_t* dt, Dtlink_t** a, Dtlink_t** b, ssize_t n)
+{
+	ssize_t		w, i, p, q, k, mid, hi;
+	Dtlink_t	**t;
+	Dtdisc_t	*disc = dt->disc;
+
+	for(w = 1; w < n; w *= 2)
+	{	for(i = 0; i < n; i += 2*w)
+		{	mid = i + w < n ? i + w : n;
+			hi = i + 2*w < n ? i + 2*w : n;
+			for(p = k = i, q = mid; p < mid && q < hi; )
+			{	if(_DTCMP(dt, OHKEY(disc,a[p]), OHKEY(disc,a[q]), disc) <= 0)
+					b[k++] = a[p++];
+				else	b[k++] = a[q++];
+			}
+			while(p < mid)
+				b[k++] = a[p++];
+			while(q < hi)
+				b[k++] = a[q++];
+		}
+		t = a; a = b; b = t;
+	}
+	return a;
+}
+
+/* make sure the list holds every object in order */
+static int ohsort(Dt_t* dt)
+{
+	Ohslot_t	*t, *endt;
+	Dtlink_t	**list, **sorted;
+	ssize_t		n, i, k;
+	Dtohash_t	*hash = (Dtohash_t*)dt->data;
+
+	if(hash->sorted)
+	{	if(hash->nhole > 0 && hash->nhole*2 > hash->nlst)
+		{	/* squeeze out the holes, keeping the finger */
+			list = hash->list;
+			for(i = k = 0, n = -1; i < hash->nlst; ++i)
+			{	if(!list[i])
+					continue;
+				if(i == hash->here)
+					n = k;
+				list[k++] = list[i];
+			}
+			hash->here = n;
+			hash->nlst = k;
+			hash->nhole = 0;
+			hash->lead = 0;
+		}
+		return 0;
+	}
+
+	n = hash->data.size;
+	if(hash->lstz < 2*n)
+	{	if(!(list = (Dtlink_t**)(*dt->memoryf)(dt, hash->list, 2*n*sizeof(Dtlink_t*), dt->disc)) )
+		{	DTERROR(dt, "Error in allocating an ordered list");
+			return -1;
+		}
+		hash->list = list;
+		hash->lstz = 2*n;
+	}
+	list = hash->list;
+	k = 0;
+	if(hash->htbl)
+	{	for(endt = (t = hash->htbl) + hash->tblz; t < endt; ++t)
+			if(t->lnk && t->lnk != OH_DELETED)
+				list[k++] = t->lnk;
+	}
+	/**/DEBUG_ASSERT(k == n);
+	if((sorted = ohmerge(dt, list, list + n, n)) != list)
+		memcpy(list, sorted, n*sizeof(Dtlink_t*));
+	hash->nlst = n;
+	hash->nhole = 0;
+	hash->lead = 0;
+	hash->here = -1;
+	hash->sorted = 1;
+	return 0;
+}
+
+/* take l out of the ordered list, or replace it with r */
+static void ohunlist(Dt_t* dt, Dtlink_t* l, Dtlink_t* r)
+{
+	ssize_t		i;
+	Dtohash_t	*hash = (Dtohash_t*)dt->data;
+
+	if(!hash->sorted)
+		return;
+	if((i = hash->here) < 0 || i >= hash->nlst || hash->list[i] != l)
+		i = ohlower(dt, OHKEY(dt->disc,l));
+	if(i < hash->nlst && hash->list[i] == l)
+	{	if(!(hash->list[i] = r))
+		{	hash->nhole += 1;
+			/* keep the holes left by deleting from either end out of searches */
+			if(i == hash->lead)
+				while(hash->lead < hash->nlst && !hash->list[hash->lead])
+					hash->lead += 1;
+			if(i == hash->nlst-1)
+				while(hash->nlst > hash->lead && !hash->list[hash->nlst-1])
+				{	hash->nlst -= 1;
+					hash->nhole -= 1;
+				}
+		}
+	}
+	else	hash->sorted = 0;
+}
+
+/* put the new object l in its place in the ordered list */
+static int ohinlist(Dt_t* dt, Dtlink_t* l)
+{
+	ssize_t		i;
+	Dtlink_t	**list;
+	Dtohash_t	*hash = (Dtohash_t*)dt->data;
+
+	i = ohlower(dt, OHKEY(dt->disc,l));
+	if(i > 0 && !hash->list[i-1])
+	{	hash->list[i-1] = l;
+		hash->nhole -= 1;
+		if(hash->lead > i-1)
+			hash->lead = i-1;
+		return 0;
+	}
+	if(hash->nlst >= hash->lstz)
+	{	if(!(list = (Dtlink_t**)(*dt->memoryf)(dt, hash->list, 2*hash->lstz*sizeof(Dtlink_t*), dt->disc)) )
+			return -1;
+		hash->list = list;
+		hash->lstz *= 2;
+	}
+	list = hash->list;
+	memmove(list+i+1, list+i, (hash->nlst-i)*sizeof(Dtlink_t*));
+	list[i] = l;
+	hash->nlst += 1;
+	if(hash->here >= i)
+		hash->here += 1;
+	return 0;
+}
+
+/* FIRST/LAST/NEXT/PREV/ATLEAST/ATMOST */
+static void* ohorder(Dt_t* dt, void* obj, int type)
+{
+	ssize_t		i, n;
+	int		found;
+	void		*key;
+	Dtlink_t	**list;
+	Dtdisc_t	*disc = dt->disc;
+	Dtohash_t	*hash = (Dtohash_t*)dt->data;
+
+	if(ohsort(dt) < 0)
+		return NULL;
+	list = hash->list;
+	n = hash->nlst;
+
+	if(type&DT_FIRST)
+	{	for(i = hash->lead; i < n && !list[i]; ++i)
+			;
+	}
+	else if(type&DT_LAST)
+	{	for(i = n-1; i >= 0 && !list[i]; --i)
+			;
+	}
+	else
+	{	if((i = hash->here) >= 0 && i < n && list[i] && _DTOBJ(disc,list[i]) == obj)
+			found = 1;
+		else
+		{	key = _DTKEY(disc,obj);
+			i = ohlower(dt, key);
+			found = i < n && _DTCMP(dt, key, OHKEY(disc,list[i]), disc) == 0;
+		}
+		if(type&DT_NEXT)
+		{	if(found)
+				for(++i; i < n && !list[i]; ++i)
+					;
+		}
+		else if((type&DT_PREV) || ((type&DT_ATMOST) && !found))
+		{	for(--i; i >= 0 && !list[i]; --i)
+				;
+		}
+	}
+
+	if(i < 0 || i >= n)
+	{	hash->here = -1;
+		return NULL;
+	}
+	hash->here = i;
+	return _DTOBJ(disc,list[i]);
+}
+
+static void* ohclear(Dt_t* dt, int type)
+{
+	Ohslot_t	*t, *endt;
+	Dtohash_t	*hash = (Dtohash_t*)dt->data;
+
+	if(hash->htbl)
+	{	for(endt = (t = hash->htbl) + hash->tblz; t < endt; ++t)
+		{	if(type && t->lnk && t->lnk != OH_DELETED)
+				_dtfree(dt, t->lnk, type);
+			t->lnk = NULL;
+		}
+	}
+	hash->data.size = 0;
+	hash->ndel = 0;
+	hash->nlst = hash->nhole = hash->lead = 0;
+	hash->here = -1;
+	hash->sorted = 0;
+
+	return NULL;
+}
+
+static void* ohlist(Dt_t* dt, Dtlink_t* list, int type)
+{
+	ssize_t		i;
+	void		*obj;
+	Ohslot_t	*t, *endt;
+	Dtlink_t	*head, *tail, *l, *next;
+	Dtohash_t	*hash = (Dtohash_t*)dt->data;
+
+	if((type&DT_EXTRACT) && !hash->sorted)
+	{	/* the dictionary is emptied anyway, so don't bother ordering it */
+		head = NULL;
+		if(hash->htbl)
+		{	for(endt = (t = hash->htbl) + hash->tblz; t < endt; ++t)
+			{	if(t->lnk && t->lnk != OH_DELETED)
+				{	t->lnk->_rght = head;
+					head = t->lnk;
+				}
+			}
+		}
+		ohclear(dt, 0);
+		return head;
+	}
+	else if(type&(DT_FLATTEN|DT_EXTRACT))
+	{	if(ohsort(dt) < 0)
+			return NULL;
+		head = tail = NULL;
+		for(i = 0; i < hash->nlst; ++i)
+		{	if(!(l = hash->list[i]) )
+				continue;
+			if(tail)
+				tail = (tail->_rght = l);
+			else	head = tail = l;
+		}
+		if(tail)
+			tail->_rght = NULL;
+		if(type&DT_EXTRACT)
+			ohclear(dt, 0);
+		return head;
+	}
+	else /* if(type&DT_RESTORE) */
+	{	dt->data->size = 0;
+		for(l = list; l; l = next)
+		{	next = l->_rght;
+			obj = _DTOBJ(dt->disc,l);
+			if((*dt->meth->searchf)(dt, l, DT_RELINK) == obj)
+				dt->data->size += 1;
+		}
+		return list;
+	}
+}
+
+static void* ohstat(Dt_t* dt, Dtstat_t* st)
+{
+	ssize_t		i, d, mask;
+	Ohslot_t	*t;
+	Dtohash_t	*hash = (Dtohash_t*)dt->data;
+
+	if(st)
+	{	memset(st, 0, sizeof(Dtstat_t));
+		st->meth  = dt->meth->type;
+		st->size  = hash->data.size;
+		st->space = sizeof(Dtohash_t) + hash->tblz*sizeof(Ohslot_t) +
+			    hash->lstz*sizeof(Dtlink_t*) +
+			    (dt->disc->link >= 0 ? 0 : hash->data.size*sizeof(Dthold_t));
+
+		/* levels are the distances of objects from their home slots */
+		mask = hash->tblz - 1;
+		for(i = 0; i < hash->tblz; ++i)
+		{	t = hash->htbl + i;
+			if(!t->lnk || t->lnk == OH_DELETED)
+				continue;
+			d = (i - (ssize_t)(t->hash & mask)) & mask;
+			if(d < DT_MAXSIZE)
+			{	st->lsize[d] += 1;
+				st->msize = d > st->msize ? d : st->msize;
+			}
+			st->mlev = d > st->mlev ? d : st->mlev;
+		}
+	}
+
+	return (void*)hash->data.size;
+}
+
+static void* dtohash(Dt_t* dt, void* obj, int type)
+{
+	Ohslot_t	*s, *fs;
+	Dtlink_t	*lnk, *l;
+	void		*key, *o;
+	uint		hsh;
+	Dtdisc_t	*disc = dt->disc;
+	Dtohash_t	*hash = (Dtohash_t*)dt->data;
+
+	type = DTTYPE(dt,type); /* map type for upward compatibility */
+	if(!(type&DT_OPERATIONS) )
+		return NULL;
+
+	DTSETLOCK(dt);
+
+	if(type&(DT_FIRST|DT_LAST|DT_CLEAR|DT_EXTRACT|DT_RESTORE|DT_FLATTEN|DT_STAT) )
+	{	if(type&(DT_FIRST|DT_LAST) )
+			DTRETURN(obj, ohorder(dt, NULL, type));
+		else if(type&DT_CLEAR)
+			DTRETURN(obj, ohclear(dt, DT_DELETE));
+		else if(type&DT_STAT)
+			DTRETURN(obj, ohstat(dt, (Dtstat_t*)obj));
+		else /*if(type&(DT_EXTRACT|DT_RESTORE|DT_FLATTEN))*/
+			DTRETURN(obj, ohlist(dt, (Dtlink_t*)obj, type));
+	}
+
+	if(!obj) /* from here on, an object prototype is required */
+		DTRETURN(obj, NULL);
+
+	if(type&(DT_NEXT|DT_PREV|DT_ATLEAST|DT_ATMOST) )
+		DTRETURN(obj, ohorder(dt, obj, type));
+
+	if(type&DT_RELINK)
+	{	lnk = (Dtlink_t*)obj;
+		obj = _DTOBJ(disc,lnk);
+		key = _DTKEY(disc,obj);
+	}
+	else
+	{	lnk = NULL;
+		if(type&DT_MATCH)
+		{	key = obj;
+			obj = NULL;
+		}
+		else	key = _DTKEY(disc,obj);
+	}
+	hsh = _DTHSH(dt,key,disc);
+
+	if((s = ohfind(dt, key, hsh, &fs)) ) /* found object */
+	{	l = s->lnk;
+		o = _DTOBJ(disc,l);
+		if(type&(DT_SEARCH|DT_MATCH) )
+			DTRETURN(obj, o);
+		else if(type&(DT_DELETE|DT_DETACH|DT_REMOVE) )
+		{	if((type&DT_REMOVE) && o != obj)
+				DTRETURN(obj, NULL);
+			ohunlist(dt, l, NULL);
+			s->lnk = OH_DELETED;
+			hash->ndel += 1;
+			hash->data.size -= 1;
+			_dtfree(dt, l, type);
+			DTRETURN(obj, o);
+		}
+		else if(type&DT_INSTALL)
+		{	/* replace old object with new one; the key and its place stay the same */
+			if(!(lnk = _dtmake(dt, obj, type)) )
+				DTRETURN(obj, NULL);
+			ohunlist(dt, l, lnk);
+			s->lnk = lnk;
+			_dtfree(dt, l, DT_DELETE);
+			DTANNOUNCE(dt, o, DT_DELETE);
+			DTRETURN(obj, _DTOBJ(disc,lnk));
+		}
+		else
+		{	/**/DEBUG_ASSERT(type&(DT_INSERT|DT_ATTACH|DT_APPEND|DT_RELINK));
+			if(type&(DT_INSERT|DT_APPEND|DT_ATTACH) )
+				type |= DT_MATCH; /* for announcement */
+			else if(lnk && (type&DT_RELINK) && lnk != l)
+			{	/* remove a duplicate */
+				o = _DTOBJ(disc, lnk);
+				_dtfree(dt, lnk, DT_DELETE);
+				DTANNOUNCE(dt, o, DT_DELETE);
+			}
+			DTRETURN(obj, _DTOBJ(disc,l));
+		}
+	}
+	else /* no matching object */
+	{	if(!(type&(DT_INSERT|DT_INSTALL|DT_APPEND|DT_ATTACH|DT_RELINK)) )
+			DTRETURN(obj, NULL);
+
+		if(!hash->htbl || OH_FULL(hash, hash->data.size + 1))
+		{	if(ohtable(dt, hash->data.size + 1) < 0)
+				DTRETURN(obj, NULL);
+			(void)ohfind(dt, key, hsh, &fs);
+		}
+
+		if(!lnk) /* inserting a new object */
+		{	if(!(lnk = _dtmake(dt, obj, type)) )
+				DTRETURN(obj, NULL);
+			hash->data.size += 1;
+		}
+
+		if(fs->lnk == OH_DELETED)
+			hash->ndel -= 1;
+		fs->hash = hsh;
+		fs->lnk = lnk;
+
+		/* keep the order of a set that is being walked, else sort it later */
+		if(hash->sorted && (hash->here < 0 || ohinlist(dt, lnk) < 0))
+			hash->sorted = 0;
+
+		DTRETURN(obj, _DTOBJ(disc,lnk));
+	}
+
+dt_return:
+	DTANNOUNCE(dt, obj, type);
+	DTCLRLOCK(dt);
+	return obj;
+}
+
+static int ohevent(Dt_t* dt, int event, void* arg)
+{
+	Dtohash_t	*hash = (Dtohash_t*)dt->data;
+
+	NOT_USED(arg);
+	if(event == DT_OPEN)
+	{	if(hash)
+			return 0;
+		if(!(hash = (Dtohash_t*)(*dt->memoryf)(dt, 0, sizeof(Dtohash_t), dt->disc)) )
+		{	DTERROR(dt, "Error in allocating an ordered hash table");
+			return -1;
+		}
+		memset(hash, 0, sizeof(Dtohash_t));
+		hash->here = -1;
+		dt->data = (Dtdata_t*)hash;
+		return 1;
+	}
+	else if(event == DT_CLOSE)
+	{	if(!hash)
+			return 0;
+		if(hash->data.size > 0 )
+			(void)ohclear(dt, DT_DELETE);
+		if(hash->htbl)
+			(void)(*dt->memoryf)(dt, hash->htbl, 0, dt->disc);
+		if(hash->list)
+			(void)(*dt->memoryf)(dt, hash->list, 0, dt->disc);
+		(void)(*dt->memoryf)(dt, hash, 0, dt->disc);
+		dt->data = NULL;
+		return 0;
+	}
+	else	return 0;
+}
+
+static Dtmethod_t	_Dtohash = { dtohash, DT_OSET, ohevent, "Dtohash" };
+Dtmethod_t		*Dtohash = &_Dtohash;
+
+#ifdef NoF
+NoF(dtohash)
+#endif
@@ -228,6 +228,7 @@ struct _dtstat_s
 extern Dtmethod_t* 	Dtset;
 extern Dtmethod_t* 	Dtbag;
 extern Dtmethod_t* 	Dtoset;
+extern Dtmethod_t* 	Dtohash;
 extern Dtmethod_t* 	Dtobag;
 extern Dtmethod_t*	Dtlist;
 extern Dtmethod_t*	Dtstack;
@@ -284,7 +285,11 @@ extern void*		dllmeth(const char*, const char*, unsigned long);
 #define dtvcount(d)	(_DT(d)->nview)
 #define dtvhere(d)	(_DT(d)->walk)
 
+#if CDT_VERSION < 20111111L
+#define dtlink(d,e)	(((Dtlink_t*)(e))->right)
+#else
 #define dtlink(d,e)	(((Dtlink_t*)(e))->rh.__rght)
+#endif
 #define dtobj(d,e)	_DTOBJ(_DT(d)->disc, (e))
 
 #define dtfirst(d)	(*(_DT(d)->searchf))((d),(void*)(0),DT_FIRST)
@@ -180,6 +180,14 @@ typedef struct regstat_s
 	regflags_t	re_info;	/* REG_* info			*/
 } regstat_t;
 
+typedef struct regcachestat_s
+{
+	int		rc_hits;	/* lookups found in the cache	*/
+	int		rc_misses;	/* lookups compiled anew	*/
+	int		rc_evictions;	/* entries reused when full	*/
+	int		rc_size;	/* max # entries		*/
+} regcachestat_t;
+
 struct regex_s
 {
 	size_t		re_nsub;	/* number of subexpressions	*/
@@ -215,6 +223,7 @@ extern void	regfatalpat(regex_t*, int, int, const char*);
 extern regstat_t* regstat(const regex_t*);
 
 extern regex_t*	regcache(const char*, regflags_t, int*);
+extern regcachestat_t* regcachestat(void);
 
 extern int	regsubcomp(regex_t*, const char*, const regflags_t*, int, regflags_t);
 extern int	regsubexec(const regex_t*, const char*, size_t, regmatch_t*);
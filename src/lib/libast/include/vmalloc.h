@@ -14,8 +14,8 @@
 ***********************************************************************/
 
 /*
- * New Vmalloc: a small interface around the standard memory allocator
- * that implements allocation regions and automatic initialization.
+ * New Vmalloc: a small region allocator on top of the standard memory
+ * allocator that implements allocation regions and automatic initialization.
  */
 
 #ifndef _VMALLOC_H
@@ -23,13 +23,29 @@
 
 #include <ast_std.h>
 
+typedef struct
+{
+	size_t		n_busy;			/* number of allocated blocks		*/
+	size_t		s_busy;			/* total size of allocated blocks	*/
+	size_t		n_free;			/* number of freed blocks kept for reuse */
+	size_t		s_free;			/* total size of those freed blocks	*/
+	size_t		n_seg;			/* number of chunks obtained by malloc	*/
+	size_t		extent;			/* total size of those chunks		*/
+} Vmstat_t;
+
 typedef struct
 {
 	/* public use */
 	uint32_t	options;		/* option bits for the region		*/
 	void		(*outofmemory)(size_t);	/* called when malloc, etc. fails	*/
 	/* internal use only */
-	void		*_list_;		/* head of allocations list		*/
+	void		*_list_;		/* chunks for small blocks, oldest first */
+	void		*_chunk_;		/* chunk small blocks are cut from	*/
+	char		*_next_;		/* next free byte in that chunk		*/
+	char		*_end_;			/* end of that chunk			*/
+	void		*_big_;			/* chunks holding one large block each	*/
+	void		*_free_[33];		/* freed small blocks by size class	*/
+	Vmstat_t	_stat_;			/* statistics for vmstat()		*/
 } Vmalloc_t;
 
 extern Vmalloc_t	*vmopen(void);
@@ -40,6 +56,7 @@ extern char		*vmstrdup(Vmalloc_t*, const char*);
 extern void		vmfree(Vmalloc_t*, void*);
 extern void		vmclear(Vmalloc_t*);
 extern void		vmclose(Vmalloc_t*);
+extern int		vmstat(Vmalloc_t*, Vmstat_t*);
 
 /* region option bits */
 #define VM_INIT		0x01			/* initialize allocated/grown memory	*/
@@ -14,28 +14,48 @@
 ***********************************************************************/
 
 /*
- * New Vmalloc: a small interface around the standard memory allocator
- * that implements allocation regions and automatic initialization.
+ * New Vmalloc: a small region allocator on top of the standard memory
+ * allocator that implements allocation regions and automatic initialization.
+ *
+ * Small blocks are cut from chunks with a bump pointer and carry only a
+ * size header; freed small blocks are kept on free lists by size class for
+ * reuse. Large blocks get a chunk of their own. vmclear() keeps the chunks
+ * for small blocks and starts cutting from the first one again, so resetting
+ * a region does not depend on the number of blocks allocated in it.
  */
 
 #include <vmalloc.h>
 
 /*
- * Keep allocations in a doubly linked list.
+ * Chunks obtained from malloc. Small chunks are kept in allocation order;
+ * each large block has a chunk in a doubly linked list of its own.
  */
-typedef struct Vmblock
+typedef struct Vmchunk
 {
-	size_t		size;		/* the size of the allocated block	*/
-	struct Vmblock	*prev;		/* previous block in list		*/
-	struct Vmblock	*next;		/* next block in list			*/
-#if __STDC_VERSION__ >= 199901L
-	max_align_t	vblock[];	/* the virtual allocated block, aligned	*/
-#else
-	max_align_t	vblock[1];	/* ...C90 fallback with struct hack	*/
-#endif
-} Vmblock_t;
-
-#define VBLOCKOFFSET	offsetof(Vmblock_t, vblock)
+	struct Vmchunk	*prev;		/* previous chunk in list		*/
+	struct Vmchunk	*next;		/* next chunk in list			*/
+	size_t		size;		/* usable size of the chunk		*/
+} Vmchunk_t;
+
+typedef struct
+{
+	char		c;
+	max_align_t	a;
+} Vmalign_t;
+
+#define VM_ALIGN	offsetof(Vmalign_t, a)
+#define VM_ROUND(n,a)	(((n) + (a) - 1) / (a) * (a))
+#define VM_GRAIN	(VM_ALIGN > 16 ? VM_ALIGN : 16)		/* size class granularity	*/
+#define VM_HEAD		VM_ROUND(sizeof(size_t), VM_ALIGN)	/* block header: its size	*/
+#define VM_CHUNKHEAD	VM_ROUND(sizeof(Vmchunk_t), VM_ALIGN)
+#define VM_NFREE	(sizeof(((Vmalloc_t*)0)->_free_) / sizeof(void*))
+#define VM_SMALL	((VM_NFREE - 1) * VM_GRAIN)		/* largest small block		*/
+#define VM_CHUNK	(8 * 1024)				/* size of first small chunk	*/
+#define VM_MAXCHUNK	(64 * 1024)				/* size of later small chunks	*/
+
+#define VM_CAP(n)	((n) ? VM_ROUND((n), VM_GRAIN) : VM_GRAIN)	/* capacity of a small block */
+#define VM_SIZE(ap)	(*(size_t*)((char*)(ap) - VM_HEAD))		/* requested size of a block */
+#define VM_BIG(ap)	((Vmchunk_t*)((char*)(ap) - VM_HEAD - VM_CHUNKHEAD))
 
 /*
  * Helper function for failure handling.
@@ -47,6 +67,79 @@ static void *fail(Vmalloc_t *vm, size_t size)
 	return NULL;
 }
 
+/*
+ * Move on to the next chunk for small blocks, reusing one kept by vmclear() if possible.
+ */
+static int newchunk(Vmalloc_t *vm)
+{
+	Vmchunk_t	*cp = vm->_chunk_, *np;
+	size_t		size;
+
+	if (!(np = cp ? cp->next : vm->_list_))
+	{
+		size = vm->_stat_.n_seg < 3 ? VM_CHUNK << vm->_stat_.n_seg : VM_MAXCHUNK;
+		if (!(np = malloc(VM_CHUNKHEAD + size)))
+			return -1;
+		np->size = size;
+		np->next = NULL;
+		if (np->prev = cp)
+			cp->next = np;
+		else
+			vm->_list_ = np;
+		vm->_stat_.n_seg++;
+		vm->_stat_.extent += VM_CHUNKHEAD + size;
+	}
+	vm->_chunk_ = np;
+	vm->_next_ = (char*)np + VM_CHUNKHEAD;
+	vm->_end_ = vm->_next_ + np->size;
+	return 0;
+}
+
+/*
+ * Allocate an uninitialized block.
+ */
+static void *alloc(Vmalloc_t *vm, size_t size)
+{
+	Vmchunk_t	*cp;
+	char		*ap;
+	size_t		cap;
+
+	if (size <= VM_SMALL)
+	{
+		cap = VM_CAP(size);
+		if (ap = vm->_free_[cap / VM_GRAIN])
+		{
+			vm->_free_[cap / VM_GRAIN] = *(void**)ap;
+			vm->_stat_.n_free--;
+			vm->_stat_.s_free -= cap;
+		}
+		else
+		{
+			if (vm->_end_ - vm->_next_ < (ptrdiff_t)(VM_HEAD + cap) && newchunk(vm) < 0)
+				return NULL;
+			ap = vm->_next_ + VM_HEAD;
+			vm->_next_ += VM_HEAD + cap;
+		}
+	}
+	else
+	{
+		if (!(cp = malloc(VM_CHUNKHEAD + VM_HEAD + size)))
+			return NULL;
+		cp->size = size;
+		cp->prev = NULL;
+		if (cp->next = vm->_big_)
+			cp->next->prev = cp;
+		vm->_big_ = cp;
+		vm->_stat_.n_seg++;
+		vm->_stat_.extent += VM_CHUNKHEAD + VM_HEAD + size;
+		ap = (char*)cp + VM_CHUNKHEAD + VM_HEAD;
+	}
+	VM_SIZE(ap) = size;
+	vm->_stat_.n_busy++;
+	vm->_stat_.s_busy += size;
+	return ap;
+}
+
 /*
  * Open a new region.
  */
@@ -60,17 +153,13 @@ Vmalloc_t *vmopen(void)
  */
 void *vmalloc(Vmalloc_t *vm, size_t size)
 {
-	Vmblock_t	*bp;
+	void	*ap;
 
-	if (!(bp = (vm->options & VM_INIT) ? calloc(1, size + VBLOCKOFFSET) : malloc(size + VBLOCKOFFSET)))
+	if (!(ap = alloc(vm, size)))
 		return fail(vm, size);
-	bp->size = size;
-	/* insert at front of list */
-	bp->prev = NULL;
-	if (bp->next = vm->_list_)
-		bp->next->prev = bp;
-	vm->_list_ = bp;
-	return (char*)bp + VBLOCKOFFSET;
+	if (vm->options & VM_INIT)
+		memset(ap, 0, size);
+	return ap;
 }
 
 /*
@@ -80,7 +169,9 @@ void *vmalloc(Vmalloc_t *vm, size_t size)
  */
 void *vmresize(Vmalloc_t *vm, void *ap, size_t size)
 {
-	Vmblock_t	*bp, *tmp;
+	Vmchunk_t	*cp, *tmp;
+	void		*np;
+	size_t		old;
 
 	if (!ap)
 		return vmalloc(vm, size);
@@ -89,30 +180,49 @@ void *vmresize(Vmalloc_t *vm, void *ap, size_t size)
 		vmfree(vm, ap);
 		return NULL;
 	}
-	bp = (Vmblock_t*)((char*)ap - VBLOCKOFFSET);
-	/* Resize block */
-	if (!(tmp = realloc(bp, size + VBLOCKOFFSET)))
+	old = VM_SIZE(ap);
+	if (old > VM_SMALL && size > VM_SMALL)
 	{
-		if (vm->options & VM_FREEONFAIL)
-			free(bp);
-		return fail(vm, size);
+		/* large block: resize its chunk */
+		cp = VM_BIG(ap);
+		if (!(tmp = realloc(cp, VM_CHUNKHEAD + VM_HEAD + size)))
+			goto nomem;
+		if (tmp != cp)
+		{
+			if (vm->_big_ == cp)
+				vm->_big_ = tmp;
+			cp = tmp;
+			ap = (char*)cp + VM_CHUNKHEAD + VM_HEAD;
+			if (cp->prev)
+				cp->prev->next = cp;
+			if (cp->next)
+				cp->next->prev = cp;
+		}
+		cp->size = size;
+		vm->_stat_.extent += size - old;
 	}
-	if (tmp != bp)
+	else if (old > VM_SMALL || size > VM_SMALL || VM_CAP(size) != VM_CAP(old))
 	{
-		if (vm->_list_ == bp)
-			vm->_list_ = tmp;
-		bp = tmp;
-		ap = (char*)bp + VBLOCKOFFSET;
-		if (bp->prev)
-			bp->prev->next = bp;
-		if (bp->next)
-			bp->next->prev = bp;
+		/* move to a block of another size class */
+		if (!(np = alloc(vm, size)))
+			goto nomem;
+		memcpy(np, ap, old < size ? old : size);
+		vmfree(vm, ap);
+		ap = np;
+		vm->_stat_.s_busy += old;	/* alloc() and vmfree() have counted the change */
+		vm->_stat_.s_busy -= size;
 	}
 	/* Initialize added memory */
-	if ((vm->options & VM_INIT) && (size > bp->size))
-		memset((char*)ap + bp->size, 0, size - bp->size);
-	bp->size = size;
+	if ((vm->options & VM_INIT) && (size > old))
+		memset((char*)ap + old, 0, size - old);
+	VM_SIZE(ap) = size;
+	vm->_stat_.s_busy += size;
+	vm->_stat_.s_busy -= old;
 	return ap;
+nomem:
+	if (vm->options & VM_FREEONFAIL)
+		vmfree(vm, ap);
+	return fail(vm, size);
 }
 
 /*
@@ -139,18 +249,12 @@ void *_Vm_newoldof_(Vmalloc_t *vm, void *ap, size_t size, int init)
  */
 char *vmstrdup(Vmalloc_t *vm, const char *s)
 {
-	Vmblock_t	*bp;
+	char		*ap;
 	size_t		size;
 
-	if (!(bp = malloc((size = strlen(s) + 1) + VBLOCKOFFSET)))
+	if (!(ap = alloc(vm, size = strlen(s) + 1)))
 		return fail(vm, size);
-	bp->size = size;
-	/* insert at front of list */
-	bp->prev = NULL;
-	if (bp->next = vm->_list_)
-		bp->next->prev = bp;
-	vm->_list_ = bp;
-	return memcpy((char*)bp + VBLOCKOFFSET, s, size);
+	return memcpy(ap, s, size);
 }
 
 /*
@@ -158,32 +262,72 @@ char *vmstrdup(Vmalloc_t *vm, const char *s)
  */
 void vmfree(Vmalloc_t *vm, void *ap)
 {
-	Vmblock_t	*bp;
+	Vmchunk_t	*cp;
+	size_t		size;
 
-	bp = (Vmblock_t*)((char*)ap - VBLOCKOFFSET);
-	if (!bp->prev)
-		vm->_list_ = bp->next;
+	if (!ap)
+		return;
+	size = VM_SIZE(ap);
+	vm->_stat_.n_busy--;
+	vm->_stat_.s_busy -= size;
+	if (size <= VM_SMALL)
+	{
+		/* keep it for reuse by the next block of its size class */
+		size = VM_CAP(size);
+		*(void**)ap = vm->_free_[size / VM_GRAIN];
+		vm->_free_[size / VM_GRAIN] = ap;
+		vm->_stat_.n_free++;
+		vm->_stat_.s_free += size;
+		return;
+	}
+	cp = VM_BIG(ap);
+	if (!cp->prev)
+		vm->_big_ = cp->next;
 	else
-		bp->prev->next = bp->next;
-	if (bp->next)
-		bp->next->prev = bp->prev;
-	free(bp);
+		cp->prev->next = cp->next;
+	if (cp->next)
+		cp->next->prev = cp->prev;
+	vm->_stat_.n_seg--;
+	vm->_stat_.extent -= VM_CHUNKHEAD + VM_HEAD + size;
+	free(cp);
+}
+
+/*
+ * Free all large blocks of a region.
+ */
+static void freebig(Vmalloc_t *vm)
+{
+	Vmchunk_t	*cp, *cpnext;
+
+	cpnext = vm->_big_;
+	while (cp = cpnext)
+	{
+		cpnext = cp->next;
+		vm->_stat_.n_seg--;
+		vm->_stat_.extent -= VM_CHUNKHEAD + VM_HEAD + cp->size;
+		free(cp);
+	}
+	vm->_big_ = NULL;
 }
 
 /*
  * Free all allocated memory from a region.
+ * The chunks for small blocks are kept and reused from the first one.
  */
 void vmclear(Vmalloc_t *vm)
 {
-	Vmblock_t	*bp, *bpnext;
+	Vmchunk_t	*cp;
 
-	bpnext = vm->_list_;
-	while (bp = bpnext)
+	freebig(vm);
+	memset(vm->_free_, 0, sizeof(vm->_free_));
+	if (cp = vm->_list_)
 	{
-		bpnext = bp->next;
-		free(bp);
+		vm->_chunk_ = cp;
+		vm->_next_ = (char*)cp + VM_CHUNKHEAD;
+		vm->_end_ = vm->_next_ + cp->size;
 	}
-	vm->_list_ = NULL;
+	vm->_stat_.n_busy = vm->_stat_.s_busy = 0;
+	vm->_stat_.n_free = vm->_stat_.s_free = 0;
 }
 
 /*
@@ -191,6 +335,25 @@ void vmclear(Vmalloc_t *vm)
  */
 void vmclose(Vmalloc_t *vm)
 {
-	vmclear(vm);
+	Vmchunk_t	*cp, *cpnext;
+
+	freebig(vm);
+	cpnext = vm->_list_;
+	while (cp = cpnext)
+	{
+		cpnext = cp->next;
+		free(cp);
+	}
 	free(vm);
 }
+
+/*
+ * Get the statistics of a region.
+ */
+int vmstat(Vmalloc_t *vm, Vmstat_t *st)
+{
+	if (!vm || !st)
+		return -1;
+	*st = vm->_stat_;
+	return 0;
+}
@@ -21,36 +21,81 @@
 /*
  * regcomp() regex_t cache
  * AT&T Research
+ *
+ * entries are found by a hash of the pattern and reflags;
+ * when the cache is full the least recently used entry is reused
  */
 
 #include <ast.h>
 #include <regex.h>
 
-#define CACHE		8		/* default # cached re's	*/
+#define CACHE		64		/* default # cached re's	*/
 #define ROUND		64		/* pattern buffer size round	*/
 
-typedef unsigned long Key_t;
-
 typedef struct Cache_s
 {
+	struct Cache_s*	next;		/* next in hash bucket		*/
+	struct Cache_s*	newer;		/* more recently used		*/
+	struct Cache_s*	older;		/* less recently used		*/
 	char*		pattern;
 	regex_t		re;
-	unsigned long	serial;
+	unsigned int	hash;
 	regflags_t	reflags;
-	int		keep;
 	int		size;
 } Cache_t;
 
 typedef struct State_s
 {
-	unsigned int	size;
-	unsigned long	serial;
+	unsigned int	size;		/* max # entries		*/
+	unsigned int	count;		/* # entries			*/
+	unsigned int	mask;		/* # buckets - 1		*/
 	char*		locale;
-	Cache_t**	cache;
+	Cache_t**	bucket;
+	Cache_t*	newest;
+	Cache_t*	oldest;
+	regcachestat_t	stat;
 } State_t;
 
 static State_t	matchstate;
 
+/*
+ * unlink cp from its hash bucket and the lru list
+ */
+
+static void
+unlink_cache(Cache_t* cp)
+{
+	Cache_t**	pp;
+
+	for (pp = &matchstate.bucket[cp->hash & matchstate.mask]; *pp != cp; pp = &(*pp)->next);
+	*pp = cp->next;
+	if (cp->newer)
+		cp->newer->older = cp->older;
+	else
+		matchstate.newest = cp->older;
+	if (cp->older)
+		cp->older->newer = cp->newer;
+	else
+		matchstate.oldest = cp->newer;
+	matchstate.count--;
+}
+
+/*
+ * make cp the most recently used entry
+ */
+
+static void
+link_lru(Cache_t* cp)
+{
+	cp->older = matchstate.newest;
+	cp->newer = 0;
+	if (matchstate.newest)
+		matchstate.newest->newer = cp;
+	else
+		matchstate.oldest = cp;
+	matchstate.newest = cp;
+}
+
 /*
  * flush the cache
  */
@@ -58,14 +103,37 @@ static State_t	matchstate;
 static void
 flushcache(void)
 {
-	int		i;
+	Cache_t*	cp;
 
-	for (i = matchstate.size; i--;)
-		if (matchstate.cache[i] && matchstate.cache[i]->keep)
-		{
-			matchstate.cache[i]->keep = 0;
-			regfree(&matchstate.cache[i]->re);
-		}
+	while (cp = matchstate.oldest)
+	{
+		unlink_cache(cp);
+		regfree(&cp->re);
+		free(cp->pattern);
+		free(cp);
+	}
+}
+
+/*
+ * (re)size the cache to hold n entries
+ */
+
+static int
+sizecache(unsigned int n)
+{
+	unsigned int	m;
+
+	flushcache();
+	for (m = 4; m < n; m <<= 1);
+	if (!(matchstate.bucket = newof(matchstate.bucket, Cache_t*, m, 0)))
+	{
+		matchstate.size = matchstate.mask = 0;
+		return 1;
+	}
+	memset(matchstate.bucket, 0, m * sizeof(Cache_t*));
+	matchstate.mask = m - 1;
+	matchstate.size = matchstate.stat.rc_size = n;
+	return 0;
 }
 
 /*
@@ -78,38 +146,28 @@ regcache(const char* pattern, regflags_t reflags, int* status)
 	Cache_t*	cp;
 	int		i;
 	char*		s;
-	int		empty;
-	int		unused;
-	int		old;
-	Key_t		key;
+	unsigned int	h;
 
 	/*
-	 * 0 pattern flushes the cache and reflags>0 extends cache
+	 * 0 pattern flushes the cache and reflags>0 sets its size
 	 */
 
 	if (!pattern)
 	{
-		flushcache();
 		i = 0;
-		if (reflags > matchstate.size)
-		{
-			if (matchstate.cache = newof(matchstate.cache, Cache_t*, reflags, 0))
-				matchstate.size = reflags;
-			else
-			{
-				matchstate.size = 0;
-				i = 1;
-			}
-		}
+		if (reflags > 0)
+			i = sizecache(reflags);
+		else
+			flushcache();
 		if (status)
 			*status = i;
 		return NULL;
 	}
-	if (!matchstate.cache)
+	if (!matchstate.bucket && sizecache(CACHE))
 	{
-		if (!(matchstate.cache = newof(0, Cache_t*, CACHE, 0)))
-			return NULL;
-		matchstate.size = CACHE;
+		if (status)
+			*status = REG_ESPACE;
+		return NULL;
 	}
 
 	/*
@@ -128,68 +186,80 @@ regcache(const char* pattern, regflags_t reflags, int* status)
 	 * check if the pattern is in the cache
 	 */
 
-	for (i = 0; i < sizeof(key) && pattern[i]; i++)
-		((char*)&key)[i] = pattern[i];
-	for (; i < sizeof(key); i++)
-		((char*)&key)[i] = 0;
-	empty = unused = -1;
-	old = 0;
-	for (i = matchstate.size; i--;)
-		if (!matchstate.cache[i])
-			empty = i;
-		else if (!matchstate.cache[i]->keep)
-			unused = i;
-		else if (*(Key_t*)matchstate.cache[i]->pattern == key && !strcmp(matchstate.cache[i]->pattern, pattern) && matchstate.cache[i]->reflags == reflags)
-			break;
-		else if (!matchstate.cache[old] || matchstate.cache[old]->serial > matchstate.cache[i]->serial)
-			old = i;
-	if (i < 0)
-	{
-		if (unused < 0)
-		{
-			if (empty < 0)
-				unused = old;
-			else
-				unused = empty;
-		}
-		if (!(cp = matchstate.cache[unused]) && !(cp = matchstate.cache[unused] = newof(0, Cache_t, 1, 0)))
+	h = strhash(pattern) ^ (unsigned int)reflags;
+	for (cp = matchstate.bucket[h & matchstate.mask]; cp; cp = cp->next)
+		if (cp->hash == h && cp->reflags == reflags && !strcmp(cp->pattern, pattern))
 		{
-			if (status)
-				*status = REG_ESPACE;
-			return NULL;
-		}
-		if (cp->keep)
-		{
-			cp->keep = 0;
-			regfree(&cp->re);
-		}
-		if ((i = strlen(pattern) + 1) > cp->size)
-		{
-			cp->size = roundof(i, ROUND);
-			if (!(cp->pattern = newof(cp->pattern, char, cp->size, 0)))
+			matchstate.stat.rc_hits++;
+			if (cp != matchstate.newest)
 			{
-				if (status)
-					*status = REG_ESPACE;
-				return NULL;
+				cp->newer->older = cp->older;
+				if (cp->older)
+					cp->older->newer = cp->newer;
+				else
+					matchstate.oldest = cp->newer;
+				link_lru(cp);
 			}
+			if (status)
+				*status = 0;
+			return &cp->re;
 		}
-		strcpy(cp->pattern, pattern);
-		while (++i < sizeof(Key_t))
-			cp->pattern[i] = 0;
-		pattern = (const char*)cp->pattern;
-		if (i = regcomp(&cp->re, pattern, reflags))
+	matchstate.stat.rc_misses++;
+
+	/*
+	 * reuse the least recently used entry if the cache is full
+	 */
+
+	if (matchstate.count >= matchstate.size)
+	{
+		cp = matchstate.oldest;
+		unlink_cache(cp);
+		regfree(&cp->re);
+		matchstate.stat.rc_evictions++;
+	}
+	else if (!(cp = newof(0, Cache_t, 1, 0)))
+	{
+		if (status)
+			*status = REG_ESPACE;
+		return NULL;
+	}
+	if ((i = strlen(pattern) + 1) > cp->size)
+	{
+		cp->size = roundof(i, ROUND);
+		if (!(cp->pattern = newof(cp->pattern, char, cp->size, 0)))
 		{
+			free(cp);
 			if (status)
-				*status = i;
+				*status = REG_ESPACE;
 			return NULL;
 		}
-		cp->keep = 1;
-		cp->reflags = reflags;
 	}
-	else
-		cp = matchstate.cache[i];
-	cp->serial = ++matchstate.serial;
+	strcpy(cp->pattern, pattern);
+	if (i = regcomp(&cp->re, cp->pattern, reflags))
+	{
+		free(cp->pattern);
+		free(cp);
+		if (status)
+			*status = i;
+		return NULL;
+	}
+	cp->hash = h;
+	cp->reflags = reflags;
+	cp->next = matchstate.bucket[h & matchstate.mask];
+	matchstate.bucket[h & matchstate.mask] = cp;
+	link_lru(cp);
+	matchstate.count++;
 	if (status)
 		*status = 0;
 	return &cp->re;
 }
+
+/*
+ * return the cache counters
+ */
+
+regcachestat_t*
+regcachestat(void)
+{
+	return &matchstate.stat;
+}
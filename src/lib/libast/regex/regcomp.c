@@ -3102,6 +3102,10 @@ regcomp(regex_t* p, const char* pattern, regflags_t flags)
 	p->env->flags = env.flags & REG_COMP;
 	p->env->min = env.stats.m;
 	p->env->nsub = env.stats.p + env.stats.u;
+	if (env.stats.x && env.stats.x->re.string.size)
+		p->env->must = env.stats.x;
+	if (!env.stats.b)
+		nfacomp(p->env);
 	return 0;
  bad:
 	regfree(p);
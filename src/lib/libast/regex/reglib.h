@@ -34,8 +34,13 @@
 
 #define alloc		_reg_alloc
 #define classfun	_reg_classfun
+#define collmatch	_reg_collmatch
 #define drop		_reg_drop
 #define fatal		_reg_fatal
+#define nfacomp		_reg_nfacomp
+#define nfaexec		_reg_nfaexec
+#define nfafree		_reg_nfafree
+#define nfasub		_reg_nfasub
 #define state		_reg_state
 
 typedef struct regsubop_s
@@ -512,9 +517,19 @@ typedef struct Rex_s
 	}		re;
 } Rex_t;
 
+/*
+ * REG_SHELL_DOT test
+ */
+
+#define LEADING(e,r,s)	(*(s)==(e)->leading&&((s)==(e)->beg||*((s)-1)==(r)->explicit))
+
+typedef struct Nfa_s Nfa_t;		/* regnfa.c automaton		*/
+
 typedef struct reglib_s			/* library private regex_t info	*/
 {
 	struct Rex_s*	rex;		/* compiled expression		*/
+	Nfa_t*		nfa;		/* rex as an automaton, or 0	*/
+	struct Rex_s*	must;		/* REX_STRING every match has	*/
 	regdisc_t*	disc;		/* REG_DISCIPLINE discipline	*/
 	const regex_t*	regex;		/* from regexec			*/
 	unsigned char*	beg;		/* beginning of string		*/
@@ -527,6 +542,7 @@ typedef struct reglib_s			/* library private regex_t info	*/
 	Stk_pos_t	stk;		/* exec stack pos		*/
 	size_t		min;		/* minimum match length		*/
 	size_t		nsub;		/* internal re_nsub		*/
+	ssize_t		budget;		/* parse() steps left if > 0	*/
 	regflags_t	flags;		/* flags from regcomp()		*/
 	int		error;		/* last error			*/
 	int		explicit;	/* explicit match on this char	*/
@@ -569,7 +585,12 @@ extern State_t		state;
 
 extern void*		alloc(regdisc_t*, void*, size_t);
 extern regclass_t	classfun(int);
+extern int		collmatch(Rex_t*, unsigned char*, unsigned char*, unsigned char**);
 extern void		drop(regdisc_t*, Rex_t*);
 extern int		fatal(regdisc_t*, int, const char*);
+extern void		nfacomp(Env_t*);
+extern int		nfaexec(Env_t*, int, int, regmatch_t*);
+extern void		nfafree(Env_t*);
+extern int		nfasub(Env_t*, regoff_t, regoff_t, regmatch_t*, int);
 
 #endif
@@ -114,12 +114,6 @@ static const char* rexname(Rex_t* rex)
 #define BEST		3	/* an unbeatable parse was found	*/
 #define BAD		4	/* error occurred			*/
 
-/*
- * REG_SHELL_DOT test
- */
-
-#define LEADING(e,r,s)	(*(s)==(e)->leading&&((s)==(e)->beg||*((s)-1)==(r)->explicit))
-
 /*
  * Pos_t is for comparing parses. An entry is made in the
  * array at the beginning and at the end of each Group_t,
@@ -642,7 +636,7 @@ collic(Celt_t* ce, char* key, char* nxt, int c, int x)
 	return collelt(ce, key, c, x);
 }
 
-static int
+int
 collmatch(Rex_t* rex, unsigned char* s, unsigned char* e, unsigned char** p)
 {
 	unsigned char*		t;
@@ -813,6 +807,11 @@ parse(Env_t* env, Rex_t* rex, Rex_t* cont, unsigned char* s)
 	for (;;)
 	{
 DEBUG_TEST(0x0008,(sfprintf(sfstdout, "AHA#%04d 0x%04x parse %s `%-.*s'\n", __LINE__, debug_flag, rexname(rex), env->end - s, s)),(0));
+		if (env->budget && (env->budget < 0 || !--env->budget))
+		{
+			env->budget = -1;
+			return BAD;
+		}
 		switch (rex->type)
 		{
 		case REX_ALT:
@@ -1772,6 +1771,31 @@ list(Env_t* env, Rex_t* rex)
 
 #endif
 
+/*
+ * nonzero if the env->must literal occurs in the subject;
+ * every match contains it, so a subject without it can't match
+ */
+
+static int
+must(Env_t* env)
+{
+	unsigned char*	t = env->must->re.string.base;
+	size_t		n = env->must->re.string.size;
+	unsigned char*	s = env->beg;
+	unsigned char*	e = env->end;
+
+	if (n == 1)
+		return memchr(s, *t, e - s) != 0;
+#if _lib_memmem
+	return memmem(s, e - s, t, n) != 0;
+#else
+	for (e -= n - 1; s < e && (s = memchr(s, *t, e - s)); s++)
+		if (!memcmp(s + 1, t + 1, n - 1))
+			return 1;
+	return 0;
+#endif
+}
+
 /*
  * returning REG_BADPAT or REG_ESPACE is not explicitly
  * countenanced by the standard
@@ -1787,6 +1811,7 @@ regnexec_20120528(const regex_t* p, const char* s, size_t len, size_t nmatch, re
 	int		m;
 	int		advance;
 	Env_t*		env;
+	regmatch_t	span;
 
 	DEBUG_INIT();
 	DEBUG_TEST(0x0001,(sfprintf(sfstdout, "AHA#%04d 0x%04x regnexec %d 0x%08x `%-.*s'\n", __LINE__, debug_flag, nmatch, flags, len, s)),(0));
@@ -1802,6 +1827,11 @@ regnexec_20120528(const regex_t* p, const char* s, size_t len, size_t nmatch, re
 	env->regex = p;
 	env->beg = (unsigned char*)s;
 	env->end = env->beg + len;
+	if (env->must && !must(env))
+	{
+		DEBUG_TEST(0x0080,(sfprintf(sfstdout, "AHA#%04d REG_NOMATCH no `%-.*s'\n", __LINE__, env->must->re.string.size, env->must->re.string.base)),(0));
+		return REG_NOMATCH;
+	}
 	env->flags &= ~REG_EXEC;
 	env->flags |= (flags & REG_EXEC);
 	advance = 0;
@@ -1828,6 +1858,29 @@ regnexec_20120528(const regex_t* p, const char* s, size_t len, size_t nmatch, re
 	DEBUG_TEST(0x1000,(list(env,env->rex)),(0));
 	k = REG_NOMATCH;
 	j = env->once || (flags & REG_LEFT);
+	if (env->nfa && (i = nfaexec(env, j, !env->stack, &span)) >= 0)
+	{
+		/*
+		 * the automaton has found whether and where the leftmost match is
+		 * in linear time; parse() is only needed for what it can't report
+		 */
+
+		if (!i)
+			goto done;
+		if (!env->stack)
+			goto found;
+		if (i > 1 && !advance && (nmatch <= 1 || !n))
+		{
+			env->best[0] = span;
+			for (i = 1; i <= n; i++)
+				env->best[i] = state.nomatch;
+			goto found;
+		}
+		s += span.rm_so;
+		env->best[0].rm_so = span.rm_so;
+	}
+	else
+		env->budget = 0;
 	DEBUG_TEST(0x0080,(sfprintf(sfstdout, "AHA#%04d parse once=%d\n", __LINE__, j)),(0));
 	while ((i = parse(env, env->rex, &env->done, (unsigned char*)s)) == NONE || advance && !env->best[0].rm_eo && !(advance = 0))
 	{
@@ -1840,6 +1893,20 @@ regnexec_20120528(const regex_t* p, const char* s, size_t len, size_t nmatch, re
 		if (env->stack)
 			env->best[0].rm_so += i;
 	}
+	if (env->budget < 0)
+	{
+		/*
+		 * parse() ran out of steps looking for the subexpressions
+		 */
+
+		env->budget = 0;
+		if ((i = nfasub(env, span.rm_so, (env->done.flags & REG_MINIMAL) ? -1 : span.rm_eo, env->best, n)) <= 0)
+		{
+			k = i ? REG_ESPACE : REG_NOMATCH;
+			goto done;
+		}
+		goto found;
+	}
 	if ((flags & REG_LEFT) && env->stack && env->best[0].rm_so)
 		goto done;
 	if (k = env->error)
@@ -1849,6 +1916,7 @@ regnexec_20120528(const regex_t* p, const char* s, size_t len, size_t nmatch, re
 		k = env->error = REG_NOMATCH;
 		goto done;
 	}
+ found:
 	if (!(env->flags & REG_NOSUB))
 	{
 		k = (env->flags & (REG_SHELL|REG_AUGMENTED)) == (REG_SHELL|REG_AUGMENTED);
@@ -1870,6 +1938,7 @@ regnexec_20120528(const regex_t* p, const char* s, size_t len, size_t nmatch, re
 	}
 	k = 0;
  done:
+	env->budget = 0;
 	stkold(env->mst, &env->stk);
 	env->stk.base = 0;
 	if (k > REG_NOMATCH)
@@ -1894,6 +1963,7 @@ regfree(regex_t* p)
 		p->env = 0;
 		if (!(env->disc->re_flags & REG_NOFREE))
 		{
+			nfafree(env);
 			drop(env->disc, env->rex);
 			if (env->pos)
 				vecclose(env->pos);
@@ -0,0 +1,926 @@
+/***********************************************************************
+*                                                                      *
+*               This software is part of the ast package               *
+*          Copyright (c) 2020-2026 Contributors to ksh 93u+m           *
+*                      and is licensed under the                       *
+*                 Eclipse Public License, Version 2.0                  *
+*                                                                      *
+*                A copy of the License is available at                 *
+*      https://www.eclipse.org/org/documents/epl-2.0/EPL-2.0.html      *
+*         (with md5 checksum 84283fa8859daf213bdda5a9f8d1be1d)         *
+*                                                                      *
+***********************************************************************/
+
+/*
+ * POSIX regex automaton executor
+ *
+ * regcomp() translates a compiled expression that has no backreferences,
+ * lookaround, negation, conjunction or callouts into a Thompson NFA, and
+ * regnexec() runs it over the subject once, carrying the set of active
+ * states from one position to the next. That finds whether there is a
+ * match and its leftmost-longest extent in time proportional to the
+ * length of the subject times the size of the expression, whatever the
+ * expression, where the backtracking parse() can take exponential time.
+ *
+ * States are keyed by the subject offset they are waiting for, in a ring
+ * of state sets, because in multibyte locales one transition may consume
+ * a character or collating element of several bytes while another
+ * consumes a single byte, just as in parse(). Each state carries the
+ * offset at which its match started; when two paths reach the same state
+ * the earlier start wins, which is what makes the result leftmost.
+ */
+
+#include "reglib.h"
+
+#define NFA_MAX		4096		/* max number of instructions	*/
+#define NFA_STEPS	8		/* parse() steps per state/byte	*/
+#define NFA_BUDGET	(1L<<22)	/* parse() steps on any subject	*/
+
+#define NFA_MATCH	0		/* the match is complete	*/
+#define NFA_SPLIT	1		/* continue at x and at y	*/
+#define NFA_JUMP	2		/* continue at x		*/
+#define NFA_LEAD	3		/* no REG_SHELL_DOT leading dot	*/
+#define NFA_ASSERT	4		/* zero-width rex->type test	*/
+#define NFA_AVAIL	5		/* at least c bytes remain	*/
+#define NFA_BYTE	6		/* the byte c			*/
+#define NFA_MAP		7		/* the byte c after rex->map	*/
+#define NFA_CLASS	8		/* a byte in rex->re.charclass	*/
+#define NFA_DOT		9		/* any byte but c		*/
+#define NFA_MBDOT	10		/* any character not starting c	*/
+#define NFA_WCHAR	11		/* the character c		*/
+#define NFA_WUPPER	12		/* the character c after towupper */
+#define NFA_COLL	13		/* a collating element in rex	*/
+#define NFA_SAVE	14		/* record offset as subexpression c */
+#define NFA_RESET	15		/* unset subexpressions c..y	*/
+
+typedef struct Nfa_op_s
+{
+	int		op;		/* NFA_* opcode			*/
+	int		c;		/* character, byte or count	*/
+	int		x;		/* next instruction		*/
+	int		y;		/* NFA_SPLIT alternative	*/
+	int		pri;		/* NFA_SPLIT tries y first	*/
+	Rex_t*		rex;		/* map, class and flags		*/
+} Nfa_op_t;
+
+typedef struct Nfa_set_s
+{
+	int		n;		/* number of states		*/
+	regoff_t*	so;		/* where their match began	*/
+	int*		pc;		/* the states			*/
+	int*		index;		/* pc[index[i]] == i if member	*/
+	regoff_t*	cap;		/* nfasub() subexpressions	*/
+} Nfa_set_t;
+
+typedef struct Nfa_undo_s
+{
+	int		pc;		/* instruction, or -1 to undo	*/
+	int		k;		/* this subexpression offset	*/
+	regoff_t	v;		/* back to this value		*/
+} Nfa_undo_t;
+
+struct Nfa_s
+{
+	Nfa_op_t*	op;		/* the program			*/
+	int		nop;		/* number of instructions	*/
+	int		max;		/* allocated instructions	*/
+	int		span;		/* max bytes one step consumes	*/
+	int		mb;		/* compiled for mbwide()	*/
+	int		minimal;	/* some node is REG_MINIMAL	*/
+	int		error;		/* cannot be translated		*/
+	Nfa_set_t*	ring;		/* span+1 pending state sets	*/
+	Nfa_set_t	run;		/* states reached at this offset */
+	unsigned int*	seen;		/* closure visit generation	*/
+	unsigned int	gen;		/* current generation		*/
+	int*		stack;		/* closure stack		*/
+	int		ncap;		/* nfasub() offsets per state	*/
+	regoff_t*	caps;		/* nfasub() cap[] arrays	*/
+	Nfa_undo_t*	undo;		/* nfasub() closure stack	*/
+};
+
+static int	nfarex(Env_t*, Nfa_t*, Rex_t*);
+
+/*
+ * append an instruction and return its index, or -1
+ */
+
+static int
+emit(Env_t* env, Nfa_t* a, int op, int c, Rex_t* rex)
+{
+	Nfa_op_t*	o;
+
+	if (a->nop >= a->max)
+	{
+		if (a->max >= NFA_MAX)
+		{
+			a->error = 1;
+			return -1;
+		}
+		a->max = a->max ? 2 * a->max : 64;
+		if (!(a->op = alloc(env->disc, a->op, a->max * sizeof(Nfa_op_t))))
+		{
+			a->error = 1;
+			return -1;
+		}
+	}
+	o = &a->op[a->nop];
+	o->op = op;
+	o->c = c;
+	o->x = a->nop + 1;
+	o->y = -1;
+	o->pri = 0;
+	o->rex = rex;
+	return a->nop++;
+}
+
+/*
+ * the Trie_t sibling list <x>; each word end is chained onto *<exit>
+ */
+
+static int
+nfatrie(Env_t* env, Nfa_t* a, Rex_t* rex, Trie_node_t* x, int* exit)
+{
+	int	i;
+	int	s;
+
+	for (; x; x = x->sib)
+	{
+		s = -1;
+		if (x->sib && (s = emit(env, a, NFA_SPLIT, 0, rex)) < 0)
+			return -1;
+		if (emit(env, a, rex->map ? NFA_MAP : NFA_BYTE, x->c, rex) < 0)
+			return -1;
+		if (x->end)
+		{
+			if ((i = emit(env, a, x->son ? NFA_SPLIT : NFA_JUMP, 0, rex)) < 0)
+				return -1;
+			if (x->son)
+			{
+				a->op[i].y = *exit;
+				a->op[i].pri = (rex->flags & REG_MINIMAL) != 0;
+			}
+			else
+				a->op[i].x = *exit;
+			*exit = i;
+		}
+		if (x->son && nfatrie(env, a, rex, x->son, exit) < 0)
+			return -1;
+		if (s >= 0)
+			a->op[s].y = a->nop;
+	}
+	return 0;
+}
+
+/*
+ * point the exits chained from <j> at <to>
+ */
+
+static void
+nfapatch(Nfa_t* a, int j, int to)
+{
+	int	k;
+
+	while (j >= 0)
+	{
+		if (a->op[j].op == NFA_SPLIT)
+		{
+			k = a->op[j].y;
+			a->op[j].y = to;
+		}
+		else
+		{
+			k = a->op[j].x;
+			a->op[j].x = to;
+		}
+		j = k;
+	}
+}
+
+/*
+ * unset the subexpressions inside numbered node <rex>, as _matchpush() does
+ */
+
+static int
+nfareset(Env_t* env, Nfa_t* a, Rex_t* rex)
+{
+	int	i;
+
+	if (rex->re.group.number <= 0 || rex->re.group.last < rex->re.group.number)
+		return 0;
+	if ((i = emit(env, a, NFA_RESET, rex->re.group.number, rex)) < 0)
+		return -1;
+	a->op[i].y = rex->re.group.last;
+	return 0;
+}
+
+/*
+ * one iteration of node <rex>
+ */
+
+static int
+nfaone(Env_t* env, Nfa_t* a, Rex_t* rex)
+{
+	unsigned char*	s;
+	unsigned char*	e;
+	int		c;
+	int		i;
+	int		j;
+	int		k;
+
+	switch (rex->type)
+	{
+	case REX_CLASS:
+		return emit(env, a, NFA_CLASS, 0, rex);
+	case REX_COLL_CLASS:
+		if (a->span < COLL_KEY_MAX)
+			a->span = COLL_KEY_MAX;
+		return emit(env, a, NFA_COLL, 0, rex);
+	case REX_DOT:
+		return emit(env, a, a->mb ? NFA_MBDOT : NFA_DOT, rex->explicit, rex);
+	case REX_ONECHAR:
+		if (!a->mb)
+			return emit(env, a, rex->map ? NFA_MAP : NFA_BYTE, rex->re.onechar, rex);
+		return emit(env, a, (rex->flags & REG_ICASE) ? NFA_WUPPER : NFA_WCHAR, rex->re.onechar, rex);
+	case REX_REP:
+		if (nfareset(env, a, rex) < 0)
+			return -1;
+		return nfarex(env, a, rex->re.group.expr.rex);
+	case REX_STRING:
+		s = rex->re.string.base;
+		e = s + rex->re.string.size;
+		if (!rex->map)
+			while (s < e)
+			{
+				if (emit(env, a, NFA_BYTE, *s++, rex) < 0)
+					return -1;
+			}
+		else if (!a->mb)
+			while (s < e)
+			{
+				if (emit(env, a, NFA_MAP, *s++, rex) < 0)
+					return -1;
+			}
+		else
+		{
+			if (emit(env, a, NFA_AVAIL, rex->re.string.size, rex) < 0)
+				return -1;
+			while (s < e)
+			{
+				c = mbchar(s);
+				if (emit(env, a, NFA_WUPPER, c, rex) < 0)
+					return -1;
+			}
+		}
+		return 0;
+	case REX_TRIE:
+		for (c = j = 0; c <= UCHAR_MAX; c++)
+			if (rex->re.trie.root[c])
+				j = c;
+		for (c = 0, k = -1; c <= UCHAR_MAX; c++)
+			if (rex->re.trie.root[c])
+			{
+				i = -1;
+				if (c < j && (i = emit(env, a, NFA_SPLIT, 0, rex)) < 0)
+					return -1;
+				if (nfatrie(env, a, rex, rex->re.trie.root[c], &k) < 0)
+					return -1;
+				if (i >= 0)
+					a->op[i].y = a->nop;
+			}
+		nfapatch(a, k, a->nop);
+		return 0;
+	}
+	a->error = 1;
+	return -1;
+}
+
+/*
+ * node <rex> with its repetition count
+ */
+
+static int
+nfanode(Env_t* env, Nfa_t* a, Rex_t* rex)
+{
+	int	i;
+	int	j;
+	int	n;
+
+	if (rex->flags & REG_MINIMAL)
+		a->minimal = 1;
+	switch (rex->type)
+	{
+	case REX_NULL:
+		return 0;
+	case REX_ALT:
+		if (nfareset(env, a, rex) < 0)
+			return -1;
+		if ((i = emit(env, a, NFA_SPLIT, 0, rex)) < 0 || nfarex(env, a, rex->re.group.expr.binary.left) < 0 || (j = emit(env, a, NFA_JUMP, 0, rex)) < 0)
+			return -1;
+		a->op[i].y = a->nop;
+		if (nfarex(env, a, rex->re.group.expr.binary.right) < 0)
+			return -1;
+		a->op[j].x = a->nop;
+		return 0;
+	case REX_GROUP:
+		if (!(n = rex->re.group.number))
+			return nfarex(env, a, rex->re.group.expr.rex);
+		if (emit(env, a, NFA_SAVE, 2 * n, rex) < 0 || nfarex(env, a, rex->re.group.expr.rex) < 0)
+			return -1;
+		return emit(env, a, NFA_SAVE, 2 * n + 1, rex);
+	case REX_BEG:
+	case REX_BEG_STR:
+	case REX_END:
+	case REX_END_STR:
+	case REX_FIN_STR:
+	case REX_WBEG:
+	case REX_WEND:
+	case REX_WORD:
+	case REX_WORD_NOT:
+		return emit(env, a, NFA_ASSERT, 0, rex);
+	case REX_CLASS:
+	case REX_COLL_CLASS:
+	case REX_DOT:
+		/* parse() tests LEADING() once, before any repetition */
+		if (env->leading >= 0 && emit(env, a, NFA_LEAD, 0, rex) < 0)
+			return -1;
+		break;
+	case REX_ONECHAR:
+	case REX_REP:
+		break;
+	case REX_STRING:
+	case REX_TRIE:
+		return nfaone(env, a, rex);
+	default:
+		a->error = 1;
+		return -1;
+	}
+	if (rex->lo > NFA_MAX || rex->hi < RE_DUP_INF && rex->hi - rex->lo > NFA_MAX)
+	{
+		a->error = 1;
+		return -1;
+	}
+	for (n = 0; n < rex->lo; n++)
+		if (nfaone(env, a, rex) < 0)
+			return -1;
+	if (rex->hi >= RE_DUP_INF)
+	{
+		if ((i = emit(env, a, NFA_SPLIT, 0, rex)) < 0 || nfaone(env, a, rex) < 0 || (j = emit(env, a, NFA_JUMP, 0, rex)) < 0)
+			return -1;
+		a->op[j].x = i;
+		a->op[i].y = a->nop;
+		a->op[i].pri = (rex->flags & REG_MINIMAL) != 0;
+		return 0;
+	}
+	/* the optional iterations all exit to the end, chained through j */
+	for (j = -1; n < rex->hi; n++)
+	{
+		if ((i = emit(env, a, NFA_SPLIT, 0, rex)) < 0 || nfaone(env, a, rex) < 0)
+			return -1;
+		a->op[i].y = j;
+		a->op[i].pri = (rex->flags & REG_MINIMAL) != 0;
+		j = i;
+	}
+	nfapatch(a, j, a->nop);
+	return 0;
+}
+
+/*
+ * the chain of nodes starting at <rex>
+ */
+
+static int
+nfarex(Env_t* env, Nfa_t* a, Rex_t* rex)
+{
+	for (; rex; rex = rex->next)
+		if (nfanode(env, a, rex) < 0)
+			return -1;
+	return a->error ? -1 : 0;
+}
+
+void
+nfafree(Env_t* env)
+{
+	Nfa_t*	a;
+	int	i;
+
+	if (a = env->nfa)
+	{
+		env->nfa = 0;
+		if (a->ring)
+		{
+			for (i = 0; i <= a->span; i++)
+				if (a->ring[i].so)
+					alloc(env->disc, a->ring[i].so, 0);
+			alloc(env->disc, a->ring, 0);
+		}
+		if (a->run.so)
+			alloc(env->disc, a->run.so, 0);
+		if (a->caps)
+			alloc(env->disc, a->caps, 0);
+		if (a->op)
+			alloc(env->disc, a->op, 0);
+		alloc(env->disc, a, 0);
+	}
+}
+
+/*
+ * translate env->rex, leaving env->nfa 0 if it can't be done
+ */
+
+void
+nfacomp(Env_t* env)
+{
+	Nfa_t*	a;
+
+	if (!(a = alloc(env->disc, 0, sizeof(Nfa_t))))
+		return;
+	memset(a, 0, sizeof(*a));
+	env->nfa = a;
+	a->mb = mbwide();
+	a->span = a->mb ? MB_LEN_MAX : 1;
+	if (env->done.flags & REG_MINIMAL)
+		a->minimal = 1;
+	if (nfarex(env, a, env->rex) < 0 || emit(env, a, NFA_MATCH, 0, &env->done) < 0)
+		nfafree(env);
+}
+
+/*
+ * allocate the state sets on first use
+ */
+
+static int
+nfaalloc(Env_t* env, Nfa_t* a)
+{
+	Nfa_set_t*	p;
+	size_t		n;
+	int		i;
+
+	n = a->nop * (sizeof(regoff_t) + 2 * sizeof(int));
+	if (!(a->ring = alloc(env->disc, 0, (a->span + 1) * sizeof(Nfa_set_t))))
+		return -1;
+	memset(a->ring, 0, (a->span + 1) * sizeof(Nfa_set_t));
+	for (i = -1; i <= a->span; i++)
+	{
+		/* the run set is followed by seen[] and stack[] */
+		p = i < 0 ? &a->run : &a->ring[i];
+		if (!(p->so = alloc(env->disc, 0, i < 0 ? 2 * n : n)))
+			return -1;
+		memset(p->so, 0, i < 0 ? 2 * n : n);
+		p->pc = (int*)(p->so + a->nop);
+		p->index = p->pc + a->nop;
+	}
+	a->seen = (unsigned int*)(a->run.index + a->nop);
+	a->stack = (int*)(a->seen + a->nop);
+	a->gen = 0;
+	return 0;
+}
+
+/*
+ * add state <pc> starting at <so> to set <p>, keeping the earlier start
+ */
+
+static int
+nfaadd(Nfa_set_t* p, int pc, regoff_t so)
+{
+	int	i;
+
+	if ((i = p->index[pc]) < p->n && p->pc[i] == pc)
+	{
+		if (so < p->so[i])
+			p->so[i] = so;
+		return 0;
+	}
+	p->index[pc] = i = p->n++;
+	p->pc[i] = pc;
+	p->so[i] = so;
+	return 1;
+}
+
+/*
+ * evaluate the zero-width NFA_ASSERT node <rex> at <s>, as parse() does
+ */
+
+static int
+nfaassert(Env_t* env, Rex_t* rex, unsigned char* s)
+{
+	unsigned char*	t;
+
+	switch (rex->type)
+	{
+	case REX_BEG:
+		return !((!(rex->flags & REG_NEWLINE) || s <= env->beg || *(s - 1) != '\n') && ((env->flags & REG_NOTBOL) || s != env->beg));
+	case REX_END:
+		return !((!(rex->flags & REG_NEWLINE) || *s != '\n') && ((env->flags & REG_NOTEOL) || s < env->end));
+	case REX_BEG_STR:
+		return s == env->beg;
+	case REX_END_STR:
+		for (t = s; t < env->end && *t == '\n'; t++);
+		return t >= env->end;
+	case REX_FIN_STR:
+		return s >= env->end;
+	case REX_WBEG:
+		return isword(*s) && !(s > env->beg && isword(*(s - 1)));
+	case REX_WEND:
+		return !isword(*s) && !(s > env->beg && !isword(*(s - 1)));
+	case REX_WORD:
+		return !(s > env->beg && isword(*(s - 1)) == isword(*s));
+	case REX_WORD_NOT:
+		return !(s == env->beg || isword(*(s - 1)) != isword(*s));
+	}
+	return 0;
+}
+
+/*
+ * the number of bytes consuming instruction <o> matches at <s>, or 0
+ */
+
+static int
+nfastep(Env_t* env, Nfa_op_t* o, unsigned char* s)
+{
+	unsigned char*	t;
+	int		c;
+
+	if (s >= env->end)
+		return 0;
+	switch (o->op)
+	{
+	case NFA_BYTE:
+		return *s == o->c;
+	case NFA_MAP:
+		return o->rex->map[*s] == o->c;
+	case NFA_CLASS:
+		return settst(o->rex->re.charclass, *s) != 0;
+	case NFA_DOT:
+		return *s != o->c;
+	case NFA_MBDOT:
+		return *s == o->c ? 0 : MBSIZE(s);
+	case NFA_WCHAR:
+	case NFA_WUPPER:
+		t = s;
+		c = mbchar(t);
+		if (o->op == NFA_WUPPER)
+			c = towupper(c);
+		if (c != o->c)
+			return 0;
+		return t > s ? t - s : 1;
+	case NFA_COLL:
+		return collmatch(o->rex, s, env->end, &t) ? (t > s ? t - s : 1) : 0;
+	}
+	return 0;
+}
+
+/*
+ * run env->nfa over env->beg..env->end, trying only the first start if
+ * <once>; return -1 if it cannot be used and 0 if there is no match;
+ * otherwise any match will do if <any>, or <m> is set to the leftmost
+ * match and 2 is returned if that is the longest match there, as parse()
+ * finds it when no part of the expression is REG_MINIMAL, or 1 if not
+ */
+
+int
+nfaexec(Env_t* env, int once, int any, regmatch_t* m)
+{
+	Nfa_t*		a = env->nfa;
+	Nfa_op_t*	o;
+	Nfa_set_t*	cur;
+	Nfa_set_t*	run = &a->run;
+	unsigned char*	s;
+	regoff_t	p;
+	regoff_t	next;
+	regoff_t	lim;
+	regoff_t	len;
+	regoff_t	so = -1;
+	regoff_t	eo = -1;
+	regoff_t	st;
+	ssize_t		live = 0;
+	int		i;
+	int		j;
+	int		k;
+	int		n;
+	int		pc;
+	int		sorted;
+
+	if (a->mb != mbwide())
+		return -1;
+	if (!a->ring && nfaalloc(env, a))
+	{
+		nfafree(env);
+		return -1;
+	}
+	for (i = 0; i <= a->span; i++)
+		a->ring[i].n = 0;
+	len = env->end - env->beg;
+	lim = len - env->min;
+	next = 0;
+	for (p = 0; p <= len; p++)
+	{
+		s = env->beg + p;
+		cur = &a->ring[p % (a->span + 1)];
+		if (p == next && so < 0 && p <= lim)
+		{
+			live += nfaadd(cur, 0, p);
+			next = once ? -1 : p < len ? p + MBSIZE(s) : len + 1;
+		}
+		if (!cur->n)
+		{
+			if (!live && (so >= 0 || next < 0 || next > lim))
+				break;
+			continue;
+		}
+		live -= cur->n;
+		/* seed the closure in order of start so that the earliest start reaches each state first */
+		for (sorted = 1, i = 1; i < cur->n; i++)
+			if (cur->so[i] < cur->so[i - 1])
+			{
+				sorted = 0;
+				break;
+			}
+		if (!sorted)
+			for (i = 1; i < cur->n; i++)
+				for (j = i; j > 0 && cur->so[j] < cur->so[j - 1]; j--)
+				{
+					k = cur->pc[j]; cur->pc[j] = cur->pc[j - 1]; cur->pc[j - 1] = k;
+					st = cur->so[j]; cur->so[j] = cur->so[j - 1]; cur->so[j - 1] = st;
+				}
+		if (!++a->gen)
+		{
+			memset(a->seen, 0, a->nop * sizeof(unsigned int));
+			a->gen = 1;
+		}
+		run->n = 0;
+		for (i = 0; i < cur->n; i++)
+		{
+			if (so >= 0 && cur->so[i] > so)
+				break;
+			st = cur->so[i];
+			n = 0;
+			if (a->seen[cur->pc[i]] != a->gen)
+			{
+				a->seen[cur->pc[i]] = a->gen;
+				a->stack[n++] = cur->pc[i];
+			}
+			while (n > 0)
+			{
+				o = &a->op[pc = a->stack[--n]];
+				switch (o->op)
+				{
+				case NFA_SPLIT:
+					if (o->y >= 0 && a->seen[o->y] != a->gen)
+					{
+						a->seen[o->y] = a->gen;
+						a->stack[n++] = o->y;
+					}
+					/* FALLTHROUGH */
+				case NFA_JUMP:
+				case NFA_SAVE:
+				case NFA_RESET:
+					k = o->x;
+					break;
+				case NFA_LEAD:
+					k = LEADING(env, o->rex, s) ? -1 : o->x;
+					break;
+				case NFA_ASSERT:
+					k = nfaassert(env, o->rex, s) ? o->x : -1;
+					break;
+				case NFA_AVAIL:
+					k = (len - p) >= o->c ? o->x : -1;
+					break;
+				default:
+					run->pc[run->n] = pc;
+					run->so[run->n++] = st;
+					continue;
+				}
+				if (k >= 0 && a->seen[k] != a->gen)
+				{
+					a->seen[k] = a->gen;
+					a->stack[n++] = k;
+				}
+			}
+		}
+		cur->n = 0;
+		for (i = 0; i < run->n; i++)
+		{
+			o = &a->op[run->pc[i]];
+			st = run->so[i];
+			if (o->op == NFA_MATCH)
+			{
+				if (any)
+					return 1;
+				if (so < 0 || st < so)
+				{
+					so = st;
+					eo = p;
+				}
+				else if (st == so)
+					eo = p;
+				continue;
+			}
+			if (k = nfastep(env, o, s))
+			{
+				if (k > a->span)
+					return -1;
+				live += nfaadd(&a->ring[(p + k) % (a->span + 1)], o->x, st);
+			}
+		}
+	}
+	if (so < 0)
+		return 0;
+	m->rm_so = so;
+	m->rm_eo = eo;
+	/*
+	 * parse() may take this many steps to find the subexpressions before
+	 * nfasub() is used; the constant lets the ordinary backtracking that
+	 * POSIX submatch rules need finish, so only exponential blowups stop
+	 */
+	env->budget = NFA_STEPS * (len + 1) * a->nop + NFA_BUDGET;
+	return a->minimal ? 1 : 2;
+}
+
+/*
+ * add state <pc> with subexpressions <cap> to set <p> unless it is there
+ */
+
+static int
+nfacap(Nfa_t* a, Nfa_set_t* p, int pc, regoff_t* cap)
+{
+	int	i;
+
+	if ((i = p->index[pc]) < p->n && p->pc[i] == pc)
+		return 0;
+	p->index[pc] = i = p->n++;
+	p->pc[i] = pc;
+	memcpy(p->cap + i * a->ncap, cap, a->ncap * sizeof(regoff_t));
+	return 1;
+}
+
+/*
+ * find subexpressions 1..<n> of the match from <so> to <eo>, or to the
+ * first end if <eo> is -1, in <match>; a Pike machine: each state carries
+ * its subexpression offsets and the state reached first, by trying the
+ * first branch of each NFA_SPLIT first, keeps its own; that is the
+ * leftmost-first rather than the POSIX choice parse() makes, but it
+ * takes linear time where parse() gave up; return 1 if found, 0 if not
+ * and -1 on error
+ */
+
+int
+nfasub(Env_t* env, regoff_t so, regoff_t eo, regmatch_t* match, int n)
+{
+	Nfa_t*		a = env->nfa;
+	Nfa_op_t*	o;
+	Nfa_set_t*	cur;
+	Nfa_set_t*	run = &a->run;
+	Nfa_undo_t*	u;
+	unsigned char*	s;
+	regoff_t*	cap;
+	regoff_t*	w;
+	regoff_t	len;
+	regoff_t	p;
+	ssize_t		live = 0;
+	size_t		z;
+	int		i;
+	int		j;
+	int		k;
+	int		pc;
+
+	if (a->ncap != 2 * (n + 1))
+	{
+		if (a->caps)
+			alloc(env->disc, a->caps, 0);
+		a->ncap = 2 * (n + 1);
+		/* a cap[] per state in each set, the working cap[] and the undo stack */
+		z = (a->span + 2) * a->nop * a->ncap + a->ncap;
+		if (!(a->caps = alloc(env->disc, 0, z * sizeof(regoff_t) + (a->nop * (a->ncap + 2) + 1) * sizeof(Nfa_undo_t))))
+		{
+			a->ncap = 0;
+			return -1;
+		}
+		for (i = 0; i <= a->span; i++)
+			a->ring[i].cap = a->caps + i * a->nop * a->ncap;
+		run->cap = a->caps + (a->span + 1) * a->nop * a->ncap;
+		a->undo = (Nfa_undo_t*)(a->caps + z);
+	}
+	w = a->caps + (a->span + 2) * a->nop * a->ncap;
+	for (i = 0; i <= a->span; i++)
+		a->ring[i].n = 0;
+	for (i = 0; i < a->ncap; i++)
+		w[i] = -1;
+	w[0] = so;
+	live += nfacap(a, &a->ring[so % (a->span + 1)], 0, w);
+	len = env->end - env->beg;
+	for (p = so; p <= len && live; p++)
+	{
+		s = env->beg + p;
+		cur = &a->ring[p % (a->span + 1)];
+		if (!cur->n)
+			continue;
+		live -= cur->n;
+		if (!++a->gen)
+		{
+			memset(a->seen, 0, a->nop * sizeof(unsigned int));
+			a->gen = 1;
+		}
+		run->n = 0;
+		for (i = 0; i < cur->n; i++)
+		{
+			memcpy(w, cur->cap + i * a->ncap, a->ncap * sizeof(regoff_t));
+			u = a->undo;
+			u->pc = cur->pc[i];
+			u++;
+			while (u > a->undo)
+			{
+				u--;
+				if ((pc = u->pc) < 0)
+				{
+					w[u->k] = u->v;
+					continue;
+				}
+				if (a->seen[pc] == a->gen)
+					continue;
+				a->seen[pc] = a->gen;
+				o = &a->op[pc];
+				k = o->x;
+				switch (o->op)
+				{
+				case NFA_SPLIT:
+					/* the preferred branch goes on top of the stack */
+					u->pc = o->pri ? o->x : o->y;
+					u++;
+					k = o->pri ? o->y : o->x;
+					break;
+				case NFA_JUMP:
+					break;
+				case NFA_SAVE:
+					u->pc = -1;
+					u->k = o->c;
+					u->v = w[o->c];
+					u++;
+					w[o->c] = p;
+					break;
+				case NFA_RESET:
+					for (j = 2 * o->c; j <= 2 * o->y + 1 && j < a->ncap; j++)
+					{
+						u->pc = -1;
+						u->k = j;
+						u->v = w[j];
+						u++;
+						w[j] = -1;
+					}
+					break;
+				case NFA_LEAD:
+					if (LEADING(env, o->rex, s))
+						k = -1;
+					break;
+				case NFA_ASSERT:
+					if (!nfaassert(env, o->rex, s))
+						k = -1;
+					break;
+				case NFA_AVAIL:
+					if ((len - p) < o->c)
+						k = -1;
+					break;
+				default:
+					run->pc[j = run->n++] = pc;
+					memcpy(run->cap + j * a->ncap, w, a->ncap * sizeof(regoff_t));
+					k = -1;
+					break;
+				}
+				if (k >= 0)
+				{
+					u->pc = k;
+					u++;
+				}
+			}
+		}
+		cur->n = 0;
+		for (i = 0; i < run->n; i++)
+		{
+			o = &a->op[run->pc[i]];
+			cap = run->cap + i * a->ncap;
+			if (o->op == NFA_MATCH)
+			{
+				if (eo < 0 || p == eo)
+				{
+					match[0].rm_so = so;
+					match[0].rm_eo = p;
+					for (j = 1; j <= n; j++)
+					{
+						match[j].rm_so = cap[2 * j];
+						match[j].rm_eo = cap[2 * j + 1];
+						if (match[j].rm_so < 0 || match[j].rm_eo < 0)
+							match[j] = state.nomatch;
+					}
+					return 1;
+				}
+				continue;
+			}
+			if (k = nfastep(env, o, s))
+			{
+				if (k > a->span)
+					return -1;
+				live += nfacap(a, &a->ring[(p + k) % (a->span + 1)], o->x, cap);
+			}
+		}
+	}
+	return 0;
+}
@@ -20,6 +20,7 @@
 #include	"sfhdr.h"
 #if defined(__linux__) && _lib_statfs
 #  include <sys/statfs.h>
+#  include <sys/syscall.h>
 #  ifndef  TMPFS_MAGIC
 #   define TMPFS_MAGIC	0x01021994
 #  endif
@@ -145,6 +146,18 @@ static int _tmpfd(void)
 			shm = NULL;
 		doshm++;
 	}
+#ifdef SYS_memfd_create
+	/*
+	 * The file would live in memory anyway, so use an anonymous one:
+	 * this saves creating and removing a name in /dev/shm
+	 */
+	if (shm && doshm == 1)
+	{
+		if ((fd = (int)syscall(SYS_memfd_create, "sftmp", 0)) >= 0)
+			return fd;
+		doshm++;
+	}
+#endif
 	if(!(file = pathtemp(NULL,PATH_MAX,shm,"sf",&fd)))
 #else
 	if(!(file = pathtemp(NULL,PATH_MAX,NULL,"sf",&fd)))
@@ -0,0 +1,278 @@
+/***********************************************************************
+*                                                                      *
+*              This file is part of the ksh 93u+m package              *
+*             Copyright (c) 2026 Contributors to ksh 93u+m             *
+*                      and is licensed under the                       *
+*                 Eclipse Public License, Version 2.0                  *
+*                                                                      *
+*                A copy of the License is available at                 *
+*      https://www.eclipse.org/org/documents/epl-2.0/EPL-2.0.html      *
+*         (with md5 checksum 84283fa8859daf213bdda5a9f8d1be1d)         *
+*                                                                      *
+***********************************************************************/
+
+/*
+ * vmtest [rounds]
+ *
+ * Stress test for the Vmalloc region allocator, run by tests/vmalloc.sh.
+ * Random vmalloc(), vmfree(), vmresize(), vmnewof() and vmstrdup() calls
+ * are checked against a shadow copy of every live block: its contents,
+ * its alignment, the zeroing done by VM_INIT and the counts kept by
+ * vmstat(). Each round ends with vmclear(), which must reuse the chunks
+ * for small blocks rather than get new ones. The sizes cover every small
+ * size class, the boundary with large blocks and moves between the two.
+ *
+ * Prints nothing and exits 0 on success, otherwise names the first
+ * failed check and exits 1.
+ */
+
+#include <ast.h>
+#include <vmalloc.h>
+
+#define NSLOT		512		/* live blocks at most		*/
+#define NOPS		20000		/* operations per round		*/
+#define SMALL		512		/* largest small block		*/
+
+typedef struct
+{
+	unsigned char	*ap;		/* the block			*/
+	size_t		size;		/* its requested size		*/
+	unsigned char	fill;		/* the byte it is filled with	*/
+} Slot_t;
+
+static Slot_t		slot[NSLOT];
+static unsigned long	seed = 1;
+static int		oom;
+static const char	*check;
+
+static unsigned long rnd(unsigned long n)
+{
+	seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+	return (seed >> 33) % n;
+}
+
+/*
+ * a random size: mostly small ones across all size classes, some around
+ * the small/large boundary and a few large ones
+ */
+static size_t rndsize(void)
+{
+	switch (rnd(10))
+	{
+	case 0:
+		return SMALL - 16 + rnd(33);
+	case 1:
+		return SMALL + rnd(32 * 1024);
+	default:
+		return rnd(SMALL + 1);
+	}
+}
+
+static void failed(const char *what, unsigned long n)
+{
+	sfprintf(sfstderr, "vmtest: %s: %s (%lu)\n", check, what, n);
+	exit(1);
+}
+
+static void outofmemory(size_t size)
+{
+	NOT_USED(size);
+	oom++;
+}
+
+/*
+ * check that a block is aligned and still holds its fill byte
+ */
+static void verify(Slot_t *sp, size_t size)
+{
+	size_t	i;
+
+	if ((uintptr_t)sp->ap % _Alignof(max_align_t))
+		failed("misaligned block", (unsigned long)sp->size);
+	for (i = 0; i < size; i++)
+		if (sp->ap[i] != sp->fill)
+			failed("block contents changed", (unsigned long)i);
+}
+
+static void fill(Slot_t *sp, size_t from)
+{
+	sp->fill = (unsigned char)(1 + rnd(255));
+	memset(sp->ap + from, sp->fill, sp->size - from);
+}
+
+/*
+ * check that vmstat() agrees with the shadow copy
+ */
+static void stats(Vmalloc_t *vm)
+{
+	Vmstat_t	st;
+	size_t		n = 0, s = 0;
+	int		i;
+
+	if (vmstat(vm, &st) < 0)
+		failed("vmstat() failed", 0);
+	for (i = 0; i < NSLOT; i++)
+		if (slot[i].ap)
+		{
+			n++;
+			s += slot[i].size;
+		}
+	if (st.n_busy != n)
+		failed("wrong number of busy blocks", (unsigned long)st.n_busy);
+	if (st.s_busy != s)
+		failed("wrong size of busy blocks", (unsigned long)st.s_busy);
+	if (st.s_free < st.n_free || (st.n_free == 0) != (st.s_free == 0))
+		failed("wrong size of free blocks", (unsigned long)st.s_free);
+	if (st.n_seg && st.extent < st.n_seg * 8)
+		failed("wrong chunk extent", (unsigned long)st.extent);
+}
+
+static void stress(Vmalloc_t *vm, int init)
+{
+	Slot_t		*sp;
+	size_t		old, i;
+	unsigned char	*np;
+	char		buf[64];
+	int		op;
+
+	vm->options = init ? VM_INIT : 0;
+	for (op = 0; op < NOPS; op++)
+	{
+		sp = &slot[rnd(NSLOT)];
+		switch (sp->ap ? rnd(6) : 0)
+		{
+		case 0:
+			/* allocate, or replace with a new block */
+			check = "vmalloc";
+			if (sp->ap)
+			{
+				verify(sp, sp->size);
+				vmfree(vm, sp->ap);
+			}
+			sp->size = rndsize();
+			if (!(sp->ap = vmalloc(vm, sp->size)))
+				failed("out of memory", (unsigned long)sp->size);
+			if (init)
+				for (i = 0; i < sp->size; i++)
+					if (sp->ap[i])
+						failed("VM_INIT block not zeroed", (unsigned long)i);
+			fill(sp, 0);
+			break;
+		case 1:
+			check = "vmfree";
+			verify(sp, sp->size);
+			vmfree(vm, sp->ap);
+			sp->ap = NULL;
+			break;
+		case 2:
+		case 3:
+			/* grow or shrink, within or across size classes */
+			check = "vmresize";
+			verify(sp, sp->size);
+			old = sp->size;
+			sp->size = rnd(2) ? rndsize() : old + rnd(64);
+			if (!(np = vmresize(vm, sp->ap, sp->size)))
+			{
+				/* resizing to 0 frees the block */
+				if (sp->size)
+					failed("out of memory", (unsigned long)sp->size);
+				sp->ap = NULL;
+				break;
+			}
+			sp->ap = np;
+			verify(sp, old < sp->size ? old : sp->size);
+			if (init)
+				for (i = old; i < sp->size; i++)
+					if (sp->ap[i])
+						failed("VM_INIT growth not zeroed", (unsigned long)i);
+			if (sp->size > old)
+				memset(sp->ap + old, sp->fill, sp->size - old);
+			break;
+		case 4:
+			/* vmnewof() zeroes growth whatever the region options */
+			check = "vmnewof";
+			verify(sp, sp->size);
+			old = sp->size;
+			sp->size = old + 1 + rnd(SMALL);
+			if (!(np = (unsigned char*)vmnewof(vm, sp->ap, char, sp->size, 0)))
+				failed("out of memory", (unsigned long)sp->size);
+			sp->ap = np;
+			verify(sp, old);
+			for (i = old; i < sp->size; i++)
+				if (sp->ap[i])
+					failed("growth not zeroed", (unsigned long)i);
+			if (vm->options != (init ? VM_INIT : 0))
+				failed("region options changed", (unsigned long)vm->options);
+			memset(sp->ap + old, sp->fill, sp->size - old);
+			break;
+		case 5:
+			check = "vmstrdup";
+			verify(sp, sp->size);
+			vmfree(vm, sp->ap);
+			sfsprintf(buf, sizeof(buf), "%0*d", (int)rnd(sizeof(buf) - 1), op);
+			if (!(sp->ap = (unsigned char*)vmstrdup(vm, buf)))
+				failed("out of memory", 0);
+			if (strcmp((char*)sp->ap, buf))
+				failed("wrong copy", (unsigned long)op);
+			sp->size = strlen(buf) + 1;
+			fill(sp, 0);
+			break;
+		}
+		stats(vm);
+	}
+	for (i = 0; i < NSLOT; i++)
+		if (slot[i].ap)
+			verify(&slot[i], slot[i].size);
+}
+
+int main(int argc, char **argv)
+{
+	Vmalloc_t	*vm;
+	Vmstat_t	st, cleared;
+	void		*ap;
+	size_t		n;
+	int		rounds = argc > 1 ? atoi(argv[1]) : 8;
+	int		r;
+
+	check = "vmopen";
+	if (!(vm = vmopen()))
+		failed("out of memory", 0);
+	for (r = 0; r < rounds; r++)
+	{
+		stress(vm, r & 1);
+		/* vmclear() frees every block and the large chunks */
+		check = "vmclear";
+		vmclear(vm);
+		memset(slot, 0, sizeof(slot));
+		stats(vm);
+		vmstat(vm, &cleared);
+		if (cleared.n_free || cleared.s_free)
+			failed("free blocks left", (unsigned long)cleared.n_free);
+		/*
+		 * but keeps the chunks for small blocks: 16-byte blocks, 32 bytes
+		 * with their header, filling all but the last 64 bytes of each
+		 * chunk must not need another one
+		 */
+		n = (cleared.extent - cleared.n_seg * 64) / 32;
+		while (n--)
+			if (!vmalloc(vm, 16))
+				failed("out of memory", 16);
+		vmstat(vm, &st);
+		if (st.n_seg != cleared.n_seg || st.extent != cleared.extent)
+			failed("chunks not reused", (unsigned long)st.n_seg);
+		vmclear(vm);
+	}
+	/* a failed resize calls outofmemory and, with VM_FREEONFAIL, frees the block */
+	check = "VM_FREEONFAIL";
+	vm->outofmemory = outofmemory;
+	vm->options = VM_FREEONFAIL;
+	if (!(ap = vmalloc(vm, 2 * SMALL)))
+		failed("out of memory", 2 * SMALL);
+	if (vmresize(vm, ap, SIZE_MAX / 2) || oom != 1)
+		failed("huge resize did not fail", (unsigned long)oom);
+	vmstat(vm, &st);
+	if (st.n_busy || st.s_busy)
+		failed("block not freed", (unsigned long)st.n_busy);
+	vmclose(vm);
+	return 0;
+}
@@ -0,0 +1,39 @@
+#!/usr/bin/env ksh
+# tests/bench-assoc.sh — time associative array operations on a large map
+#
+# Fills a map with KEYS subscripts (default 1000000), then times LOOKUPS
+# (default 200000) reads of present subscripts, the same number of reads
+# of missing ones, and one walk over ${!map[@]}. Run it with each shell to
+# compare; it checks nothing and is not part of the test suite.
+#
+# Usage: build/<host>/bin/ksh tests/bench-assoc.sh [KEYS [LOOKUPS]]
+
+integer keys=${1:-1000000} lookups=${2:-200000} i n
+typeset -F3 t0
+typeset -A map
+
+t0=SECONDS
+for ((i=0; i<keys; i++))
+do	map[k$i]=$i
+done
+printf "%-6s %8d %-6s %7.3fs\n" fill $keys keys "$((SECONDS-t0))"
+
+t0=SECONDS
+for ((i=0; i<lookups; i++))
+do	: "${map[k$((i*7919%keys))]}"
+done
+printf "%-6s %8d %-6s %7.3fs\n" hit $lookups reads "$((SECONDS-t0))"
+
+t0=SECONDS
+for ((i=0; i<lookups; i++))
+do	: "${map[x$i]}"
+done
+printf "%-6s %8d %-6s %7.3fs\n" miss $lookups reads "$((SECONDS-t0))"
+
+t0=SECONDS
+n=0
+for k in "${!map[@]}"
+do	((n++))
+done
+printf "%-6s %8d %-6s %7.3fs\n" walk $n keys "$((SECONDS-t0))"
+(( n == keys )) || { print -u2 "bench-assoc: $n keys, expected $keys"; exit 1; }
@@ -33,7 +33,7 @@ fast        comvar comvario cubetype enum exit expand functions glob
 fast        grep loop math nameref namespace pointtype posix quoting
 fast        quoting2 readcsv readonly recttype restricted return
 fast        sh_match statics substring tilde timetype treemove types
-fast        variables vartree1 vartree2
+fast        variables vartree1 vartree2 vmalloc
 
 # Tests sensitive to platform path layout (NixOS vs FHS)
 platform    builtins path libcmd